@@ -0,0 +1,73 @@
+#pragma once
+
+// 基准与测试共用的小工具：计时、CPU 时间、让读取库启动 fake-cava 代替真正的 cava
+
+#include <algorithm>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <time.h>
+#include <vector>
+#include <sys/resource.h>
+
+static inline uint64_t bench_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// 本进程（全部线程）的 user + sys CPU 时间
+static inline uint64_t bench_process_cpu_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// 本进程的自愿 + 非自愿上下文切换次数
+static inline uint64_t bench_context_switches() {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (uint64_t)(ru.ru_nvcsw + ru.ru_nivcsw);
+}
+
+// /proc/self/io 中的 syscr（read 类系统调用次数）
+static inline uint64_t bench_read_syscalls() {
+    FILE *f = fopen("/proc/self/io", "r");
+    if (!f) return 0;
+    char key[32];
+    unsigned long long value = 0, syscr = 0;
+    while (fscanf(f, "%31[^:]: %llu\n", key, &value) == 2) {
+        if (std::string(key) == "syscr") syscr = value;
+    }
+    fclose(f);
+    return syscr;
+}
+
+// 把构建目录里的 fake-cava（输出名为 cava）放到 PATH 最前面，之后启动的 reader 都会用它。
+// fps < 0 时沿用配置里的帧率，0 表示不限速；frames < 0 表示不退出
+static inline void fake_cava_use(double fps, long frames = -1, long work_us = 0) {
+    std::string path = FAKE_CAVA_DIR;
+    const char *old = getenv("PATH");
+    if (old && *old) path += std::string(":") + old;
+    setenv("PATH", path.c_str(), 1);
+    if (fps >= 0) {
+        setenv("FAKE_CAVA_FPS", std::to_string(fps).c_str(), 1);
+    } else {
+        unsetenv("FAKE_CAVA_FPS");
+    }
+    if (frames >= 0) {
+        setenv("FAKE_CAVA_FRAMES", std::to_string(frames).c_str(), 1);
+    } else {
+        unsetenv("FAKE_CAVA_FRAMES");
+    }
+    setenv("FAKE_CAVA_WORK_US", std::to_string(work_us).c_str(), 1);
+}
+
+// 排序后取百分位（p 为 0..100）
+static inline uint64_t bench_percentile(std::vector<uint64_t> values, double p) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    size_t index = (size_t)(p / 100.0 * (double)(values.size() - 1) + 0.5);
+    return values[std::min(index, values.size() - 1)];
+}
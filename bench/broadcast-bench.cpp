@@ -0,0 +1,102 @@
+// 广播模式的读者竞争：1/2/4/8 个游标线程（cava_cursor_wait + cava_cursor_read），512 柱，
+// 1000 fps 与不限速的 fake-cava，各运行固定时长。报告发布帧率、生产者每帧解码耗时
+// （decode_ns_avg：读者读取的槽位缓存行要被生产者重新取回，读者越多若它上升即说明读者拖慢了生产者）、
+// 读者平均读到与错过的帧占比、每发布一帧的上下文切换与进程 CPU 时间（含全部读者）。
+// 用法: broadcast-bench [每项秒数，默认 2]
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <time.h>
+#include <vector>
+
+#include "bench-util.hpp"
+#include "cava-input.hpp"
+
+static const size_t bars = 512;
+
+struct Reader {
+    cava_cursor *cursor;
+    uint64_t read = 0;
+};
+
+static void run_reader(Reader *reader, const std::atomic<bool> *stop) {
+    std::vector<float> frame(bars);
+    while (!stop->load(std::memory_order_relaxed)) {
+        if (cava_cursor_wait(reader->cursor, 10000000) != 1) continue;
+        while (cava_cursor_read(reader->cursor, frame.data(), frame.size(), nullptr) == 1) reader->read++;
+    }
+}
+
+int main(int argc, char **argv) {
+    double seconds = argc > 1 ? atof(argv[1]) : 2.0;
+    const double rates[] = { 1000, 0 };
+    printf("%-9s %7s %12s %10s %8s %8s %12s %13s\n", "fps", "readers", "published/s", "decode_ns", "read%",
+           "missed%", "ctxsw/frame", "cpu_us/frame");
+    for (double fps : rates) {
+        for (int readers : { 1, 2, 4, 8 }) {
+            fake_cava_use(fps);
+            cava_reader_options opts;
+            cava_reader_options_init(&opts);
+            opts.bars_number = bars;
+            opts.ring_mode = CAVA_RING_BROADCAST;
+            opts.ring_capacity = 16;
+            cava_stream *stream = cava_stream_start(&opts);
+            if (!stream) {
+                fprintf(stderr, "cava_stream_start failed\n");
+                return 1;
+            }
+            // 等 cava 开始输出
+            struct cava_reader_stats s0, s1;
+            for (;;) {
+                cava_stream_stats(stream, &s0);
+                if (s0.frames_published > 0) break;
+                struct timespec ts = { 0, 1000000 };
+                nanosleep(&ts, nullptr);
+            }
+
+            std::atomic<bool> stop{false};
+            std::vector<Reader> state(readers);
+            for (Reader &r : state) r.cursor = cava_stream_cursor_open(stream);
+            cava_stream_stats(stream, &s0);
+            uint64_t csw0 = bench_context_switches();
+            uint64_t cpu0 = bench_process_cpu_ns();
+            uint64_t t0 = bench_now_ns();
+            std::vector<std::thread> threads;
+            for (Reader &r : state) threads.emplace_back(run_reader, &r, &stop);
+            struct timespec ts = { (time_t)seconds, (long)((seconds - (double)(time_t)seconds) * 1e9) };
+            nanosleep(&ts, nullptr);
+            stop.store(true);
+            for (std::thread &t : threads) t.join();
+            uint64_t elapsed = bench_now_ns() - t0;
+            uint64_t cpu = bench_process_cpu_ns() - cpu0;
+            uint64_t csw = bench_context_switches() - csw0;
+            cava_stream_stats(stream, &s1);
+
+            uint64_t published = s1.frames_published - s0.frames_published;
+            uint64_t read = 0, missed = 0;
+            for (Reader &r : state) {
+                read += r.read;
+                missed += cava_cursor_missed(r.cursor);
+                cava_cursor_close(r.cursor);
+            }
+            cava_stream_stop(stream);
+
+            // 每个读者应读到的帧数约为 published（游标打开时刻与计时起点几乎相同）
+            double expected = (double)published * readers;
+            char label[16];
+            if (fps > 0) {
+                snprintf(label, sizeof label, "%.0f", fps);
+            } else {
+                snprintf(label, sizeof label, "unpaced");
+            }
+            printf("%-9s %7d %12.0f %10llu %8.1f %8.1f %12.2f %13.2f\n", label, readers,
+                   (double)published * 1e9 / (double)elapsed, (unsigned long long)s1.decode_ns_avg,
+                   expected > 0 ? 100.0 * (double)read / expected : 0.0,
+                   expected > 0 ? 100.0 * (double)missed / expected : 0.0,
+                   published ? (double)csw / (double)published : 0.0,
+                   published ? (double)cpu / 1e3 / (double)published : 0.0);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,54 @@
+// 各解码内核每帧耗时：u16/u8 及逆序版本，128/512/2048 个样本，热缓存。
+// 用法: decode-bench [每项迭代次数，默认 200000]
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "bench-util.hpp"
+#include "cava-decode.hpp"
+
+struct Kernel {
+    const char *name;
+    size_t sample_bytes;
+    float scale;
+    cava_decode_fn cava_decoder::*fn;
+};
+
+static const Kernel kernels[] = {
+    { "u16", 2, 1.0f / 65535.0f, &cava_decoder::u16 },
+    { "u8", 1, 1.0f / 255.0f, &cava_decoder::u8 },
+    { "u16_rev", 2, 1.0f / 65535.0f, &cava_decoder::u16_rev },
+    { "u8_rev", 1, 1.0f / 255.0f, &cava_decoder::u8_rev },
+};
+
+static volatile float sink;
+
+int main(int argc, char **argv) {
+    long iterations = argc > 1 ? atol(argv[1]) : 200000;
+    const size_t counts[] = { 128, 512, 2048 };
+    std::vector<uint8_t> src(2048 * 2);
+    for (size_t i = 0; i < src.size(); i++) src[i] = (uint8_t)(i * 31);
+    std::vector<float> dst(2048);
+
+    printf("selected: %s\n", cava_decoder_select()->name);
+    printf("%-8s %-8s %8s %12s\n", "level", "kernel", "samples", "ns/frame");
+    for (int level = CAVA_SIMD_SCALAR; level <= CAVA_SIMD_NEON; level++) {
+        const cava_decoder *decoder = cava_decoder_get(level);
+        if (!decoder) continue;
+        for (const Kernel &k : kernels) {
+            cava_decode_fn fn = decoder->*(k.fn);
+            for (size_t count : counts) {
+                // 大帧少跑几次，保持每项用时相近
+                long n = iterations * 128 / (long)count;
+                uint64_t t0 = bench_now_ns();
+                for (long it = 0; it < n; it++) {
+                    fn(src.data(), dst.data(), count, k.scale);
+                    sink = dst[it & 127];
+                }
+                double ns = (double)(bench_now_ns() - t0) / (double)n;
+                printf("%-8s %-8s %8zu %12.1f\n", decoder->name, k.name, count, ns);
+            }
+        }
+    }
+    return 0;
+}
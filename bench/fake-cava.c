@@ -0,0 +1,114 @@
+// 代替 cava 的假生产者，测试与基准用：按 `cava -p <config>` 读取 bars、bit_format、framerate、raw_target，
+// 以固定节奏写出 raw 帧，收到 SIGUSR1 时重新读取配置，并像 cava 一样关闭后重新打开 raw_target。
+// 第 n 帧的第 i 个样本为 (n + i) 截断到样本宽度，使用者可据此校验帧内容与顺序。
+// 环境变量：
+//   FAKE_CAVA_FPS     覆盖配置中的帧率；0 表示不限速，尽快写
+//   FAKE_CAVA_FRAMES  写出这么多帧后退出（默认不退出）
+//   FAKE_CAVA_WORK_US 每帧空转这么多微秒的 CPU，模拟 cava 的采集与 FFT 开销
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static volatile sig_atomic_t reload;
+static const char *config_path;
+static int bars = 128;
+static int sample_bytes = 2;
+static double fps = 65.0;
+static char raw_target[256] = "/dev/stdout";
+
+static void on_usr1(int sig) {
+    (void)sig;
+    reload = 1;
+}
+
+// 与 iniparser 一样：值两端的空白被去掉，数字按 strtol(..., 0) 解析
+static void load_config(void) {
+    FILE *f = config_path ? fopen(config_path, "r") : NULL;
+    char line[512];
+    while (f && fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\n")] = '\0';
+        if (!strncmp(line, "bars = ", 7)) bars = (int)strtol(line + 7, NULL, 0);
+        if (!strncmp(line, "framerate = ", 12)) fps = (double)strtol(line + 12, NULL, 0);
+        if (!strncmp(line, "bit_format = ", 13)) sample_bytes = strstr(line + 13, "8bit") ? 1 : 2;
+        if (!strncmp(line, "raw_target = ", 13)) snprintf(raw_target, sizeof(raw_target), "%s", line + 13);
+    }
+    if (f) fclose(f);
+    const char *env = getenv("FAKE_CAVA_FPS");
+    if (env) fps = atof(env);
+}
+
+static void burn_cpu_us(long us) {
+    struct timespec a, b;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &a);
+    do {
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &b);
+    } while ((b.tv_sec - a.tv_sec) * 1000000L + (b.tv_nsec - a.tv_nsec) / 1000 < us);
+}
+
+int main(int argc, char **argv) {
+    for (int i = 1; i < argc - 1; i++) {
+        if (!strcmp(argv[i], "-p")) config_path = argv[i + 1];
+    }
+    signal(SIGUSR1, on_usr1);
+    signal(SIGPIPE, SIG_IGN);
+    load_config();
+    long frames = getenv("FAKE_CAVA_FRAMES") ? atol(getenv("FAKE_CAVA_FRAMES")) : -1;
+    long work_us = getenv("FAKE_CAVA_WORK_US") ? atol(getenv("FAKE_CAVA_WORK_US")) : 0;
+
+    int out = 1;
+    if (strcmp(raw_target, "/dev/stdout") != 0) {
+        out = open(raw_target, O_WRONLY | O_CLOEXEC);
+        if (out < 0) return 1;
+    }
+
+    uint8_t *buf = malloc((size_t)bars * 2);
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    for (long n = 0; frames < 0 || n < frames; n++) {
+        if (reload) {
+            reload = 0;
+            load_config();
+            // cava 重新加载配置时重建输出：raw_target 是文件或 FIFO 时先关闭再打开
+            if (out != 1) {
+                close(out);
+                out = open(raw_target, O_WRONLY | O_CLOEXEC);
+                if (out < 0) return 1;
+            }
+        }
+        if (work_us > 0) burn_cpu_us(work_us);
+        for (int i = 0; i < bars; i++) {
+            uint32_t v = (uint32_t)(n + i);
+            if (sample_bytes == 2) {
+                buf[i * 2] = (uint8_t)v;
+                buf[i * 2 + 1] = (uint8_t)(v >> 8);
+            } else {
+                buf[i] = (uint8_t)v;
+            }
+        }
+        size_t size = (size_t)bars * sample_bytes;
+        for (size_t off = 0; off < size;) {
+            ssize_t w = write(out, buf + off, size - off);
+            if (w < 0 && errno == EINTR) continue;
+            if (w <= 0) return 0;
+            off += (size_t)w;
+        }
+        if (fps > 0) {
+            long period = (long)(1e9 / fps);
+            next.tv_nsec += period;
+            while (next.tv_nsec >= 1000000000L) {
+                next.tv_nsec -= 1000000000L;
+                next.tv_sec++;
+            }
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR) {
+            }
+        }
+    }
+    free(buf);
+    return 0;
+}
@@ -0,0 +1,60 @@
+// 读取线程的系统调用与 CPU 开销：512 柱，65/144/240 fps 及不限速，各运行固定时长。
+// 消费者在测量期间只睡眠（邮箱模式，不需要取帧），因此进程的 read 类系统调用与 CPU 时间
+// 都来自读取线程。reads/frame < 1 表示一次 read 取到了多帧。
+// 用法: read-batch [每项秒数，默认 3]
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "bench-util.hpp"
+#include "cava-input.hpp"
+
+int main(int argc, char **argv) {
+    double seconds = argc > 1 ? atof(argv[1]) : 3.0;
+    const double rates[] = { 65, 144, 240, 0 };
+    printf("%-9s %10s %12s %12s %12s %14s\n", "fps", "frames/s", "syscalls/s", "reads/frame", "cpu_us/s",
+           "cpu_us/frame");
+    for (double fps : rates) {
+        fake_cava_use(fps);
+        cava_reader_options opts;
+        cava_reader_options_init(&opts);
+        opts.bars_number = 512;
+        opts.ring_mode = CAVA_RING_LATEST;
+        opts.backend = CAVA_BACKEND_READ;
+        cava_stream *stream = cava_stream_start(&opts);
+        if (!stream) {
+            fprintf(stderr, "cava_stream_start failed\n");
+            return 1;
+        }
+        // 等 cava 启动并开始输出后再计时
+        float first[512];
+        cava_stream_wait_pop(stream, first, 512, 1000000000);
+
+        struct cava_reader_stats s0, s1;
+        cava_stream_stats(stream, &s0);
+        uint64_t sys0 = bench_read_syscalls();
+        uint64_t cpu0 = bench_process_cpu_ns();
+        uint64_t t0 = bench_now_ns();
+        struct timespec ts = { (time_t)seconds, (long)((seconds - (double)(time_t)seconds) * 1e9) };
+        nanosleep(&ts, nullptr);
+        uint64_t elapsed = bench_now_ns() - t0;
+        uint64_t cpu = bench_process_cpu_ns() - cpu0;
+        uint64_t sys = bench_read_syscalls() - sys0;
+        cava_stream_stats(stream, &s1);
+        cava_stream_stop(stream);
+
+        double secs = (double)elapsed / 1e9;
+        uint64_t frames = s1.frames_received - s0.frames_received;
+        uint64_t reads = s1.reads - s0.reads;
+        char label[16];
+        if (fps > 0) {
+            snprintf(label, sizeof label, "%.0f", fps);
+        } else {
+            snprintf(label, sizeof label, "unpaced");
+        }
+        printf("%-9s %10.0f %12.0f %12.3f %12.0f %14.2f\n", label, (double)frames / secs, (double)sys / secs,
+               frames ? (double)reads / (double)frames : 0.0, (double)cpu / 1e3 / secs,
+               frames ? (double)cpu / 1e3 / (double)frames : 0.0);
+    }
+    return 0;
+}
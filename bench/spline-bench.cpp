@@ -0,0 +1,71 @@
+// GPU 与 CPU 样条路径每帧的 CPU 开销与上传量（对应客户端 [Perf] 行的 cpu_us/frame、upload_bytes/frame）。
+//   cpu-spline: 细分成三角带并写入顶点缓冲（映射的流式缓冲用普通内存代替）
+//   gpu-float:  计算控制点与切线，交错写入 RG32F 纹理的上传缓冲
+//   gpu-raw:    原始整数样本原样复制进像素解包缓冲，控制点与切线由着色器计算
+// 只测 CPU 侧；GPU 上的着色器耗时需要 GL 上下文，在客户端里看。
+// 用法: spline-bench [帧数，默认 2000]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+#include "spline.hpp"
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// 防止编译器把结果当作无用计算删掉
+static volatile int sink;
+
+int main(int argc, char **argv) {
+    int frames = argc > 1 ? atoi(argv[1]) : 2000;
+    const size_t bar_counts[] = { 64, 256, 1024 };
+    printf("%-6s %-10s %12s %14s\n", "bars", "path", "us/frame", "bytes/frame");
+    for (size_t n : bar_counts) {
+        // 一组缓慢变化的伪频谱帧，避免每帧完全相同
+        std::vector<std::vector<float>> input(16, std::vector<float>(n));
+        std::vector<std::vector<uint16_t>> raw(16, std::vector<uint16_t>(n));
+        for (size_t f = 0; f < input.size(); f++) {
+            for (size_t i = 0; i < n; i++) {
+                raw[f][i] = (uint16_t)((i * 977 + f * 131) % 65536);
+                input[f][i] = raw[f][i] / 65535.0f;
+            }
+        }
+
+        // 与客户端一样，暂存跨帧复用
+        std::vector<float> control_points, tangents;
+        std::vector<int16_t> vertices(spline_strip_vertices(n) * 2);
+        uint64_t t0 = now_ns();
+        for (int f = 0; f < frames; f++) {
+            write_spline_strip(vertices.data(), input[f % input.size()].data(), n, -1.0f, 1.0f, control_points,
+                               tangents);
+            sink = vertices[f % vertices.size()];
+        }
+        uint64_t cpu_ns = now_ns() - t0;
+
+        std::vector<float> row(n * 2);
+        t0 = now_ns();
+        for (int f = 0; f < frames; f++) {
+            pack_spline_points(input[f % input.size()].data(), n, control_points, tangents, row.data());
+            sink = (int)row[f % row.size()];
+        }
+        uint64_t gpu_float_ns = now_ns() - t0;
+
+        std::vector<uint16_t> staging(n);
+        t0 = now_ns();
+        for (int f = 0; f < frames; f++) {
+            memcpy(staging.data(), raw[f % raw.size()].data(), n * sizeof(uint16_t));
+            sink = staging[f % n];
+        }
+        uint64_t gpu_raw_ns = now_ns() - t0;
+
+        printf("%-6zu %-10s %12.2f %14zu\n", n, "cpu-spline", cpu_ns / 1e3 / frames, vertices.size() * sizeof(int16_t));
+        printf("%-6zu %-10s %12.2f %14zu\n", n, "gpu-float", gpu_float_ns / 1e3 / frames, row.size() * sizeof(float));
+        printf("%-6zu %-10s %12.2f %14zu\n", n, "gpu-raw", gpu_raw_ns / 1e3 / frames, n * sizeof(uint16_t));
+    }
+    return 0;
+}
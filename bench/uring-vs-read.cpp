@@ -0,0 +1,67 @@
+// io_uring 后端与 read() 后端对比：高柱数、高帧率及不限速的 fake-cava，各运行固定时长，
+// 报告每帧读取线程 CPU 时间与上下文切换。消费者在测量期间只睡眠（邮箱模式），
+// 进程的 CPU 时间都来自读取线程。内核不支持 io_uring 时 reader 会打印回退提示，两列结果相同。
+// 用法: uring-vs-read [每项秒数，默认 2]
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+
+#include "bench-util.hpp"
+#include "cava-input.hpp"
+
+int main(int argc, char **argv) {
+    double seconds = argc > 1 ? atof(argv[1]) : 2.0;
+    const size_t bars[] = { 512, 2048, 8192 };
+    const double rates[] = { 240, 1000, 0 };
+    printf("%-9s %6s %-8s %10s %12s %14s %12s\n", "fps", "bars", "backend", "frames/s", "reads/frame",
+           "cpu_us/frame", "ctxsw/frame");
+    for (size_t bar_count : bars) {
+        for (double fps : rates) {
+            for (int backend : { CAVA_BACKEND_READ, CAVA_BACKEND_IO_URING }) {
+                fake_cava_use(fps);
+                cava_reader_options opts;
+                cava_reader_options_init(&opts);
+                opts.bars_number = bar_count;
+                opts.ring_mode = CAVA_RING_LATEST;
+                opts.backend = backend;
+                cava_stream *stream = cava_stream_start(&opts);
+                if (!stream) {
+                    fprintf(stderr, "cava_stream_start failed\n");
+                    return 1;
+                }
+                // 等 cava 启动并开始输出后再计时
+                std::vector<float> first(bar_count);
+                cava_stream_wait_pop(stream, first.data(), first.size(), 1000000000);
+
+                struct cava_reader_stats s0, s1;
+                cava_stream_stats(stream, &s0);
+                uint64_t csw0 = bench_context_switches();
+                uint64_t cpu0 = bench_process_cpu_ns();
+                uint64_t t0 = bench_now_ns();
+                struct timespec ts = { (time_t)seconds, (long)((seconds - (double)(time_t)seconds) * 1e9) };
+                nanosleep(&ts, nullptr);
+                uint64_t elapsed = bench_now_ns() - t0;
+                uint64_t cpu = bench_process_cpu_ns() - cpu0;
+                uint64_t csw = bench_context_switches() - csw0;
+                cava_stream_stats(stream, &s1);
+                cava_stream_stop(stream);
+
+                uint64_t frames = s1.frames_received - s0.frames_received;
+                uint64_t reads = s1.reads - s0.reads;
+                char label[16];
+                if (fps > 0) {
+                    snprintf(label, sizeof label, "%.0f", fps);
+                } else {
+                    snprintf(label, sizeof label, "unpaced");
+                }
+                printf("%-9s %6zu %-8s %10.0f %12.3f %14.2f %12.2f\n", label, bar_count,
+                       backend == CAVA_BACKEND_READ ? "read" : "io_uring", (double)frames * 1e9 / (double)elapsed,
+                       frames ? (double)reads / (double)frames : 0.0,
+                       frames ? (double)cpu / 1e3 / (double)frames : 0.0,
+                       frames ? (double)csw / (double)frames : 0.0);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,55 @@
+// 发布到唤醒的延迟：消费者阻塞在 cava_stream_wait_pop 上，醒来后立即读取 ns_since_last_frame，
+// 即读取线程发布这一帧（eventfd 写入）到 wait_pop 返回的时间。也报告每帧上下文切换次数
+// （CPU 时间不报告：每帧一次的 stats 会读取 /proc，开销比等待本身还大）。
+// 用法: wake-latency [每种帧率的帧数，默认 300]
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "bench-util.hpp"
+#include "cava-input.hpp"
+
+int main(int argc, char **argv) {
+    int frames = argc > 1 ? atoi(argv[1]) : 300;
+    const double rates[] = { 65, 144, 1000 };
+    printf("%-6s %-7s %10s %10s %10s %10s %12s\n", "fps", "mode", "p50_us", "p99_us", "max_us",
+           "timeouts", "ctxsw/frame");
+    for (double fps : rates) {
+        for (int mode : { CAVA_RING_QUEUE, CAVA_RING_LATEST }) {
+            fake_cava_use(fps);
+            cava_reader_options opts;
+            cava_reader_options_init(&opts);
+            opts.ring_mode = mode;
+            cava_stream *stream = cava_stream_start(&opts);
+            if (!stream) {
+                fprintf(stderr, "cava_stream_start failed\n");
+                return 1;
+            }
+            std::vector<float> frame(cava_stream_bars_number(stream) * cava_stream_channels(stream));
+            // 丢掉启动阶段（cava 的首帧到达时间与后续无关）
+            cava_stream_wait_pop(stream, frame.data(), frame.size(), 1000000000);
+
+            std::vector<uint64_t> latencies;
+            int timeouts = 0;
+            uint64_t csw0 = bench_context_switches();
+            for (int i = 0; i < frames; i++) {
+                int r = cava_stream_wait_pop(stream, frame.data(), frame.size(), 1000000000);
+                struct cava_reader_stats stats;
+                cava_stream_stats(stream, &stats);
+                if (r != 1) {
+                    timeouts++;
+                    continue;
+                }
+                latencies.push_back(stats.ns_since_last_frame);
+            }
+            uint64_t csw = bench_context_switches() - csw0;
+            cava_stream_stop(stream);
+
+            printf("%-6.0f %-7s %10.1f %10.1f %10.1f %10d %12.2f\n", fps,
+                   mode == CAVA_RING_QUEUE ? "queue" : "latest",
+                   bench_percentile(latencies, 50) / 1e3, bench_percentile(latencies, 99) / 1e3,
+                   bench_percentile(latencies, 100) / 1e3, timeouts, (double)csw / frames);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// cava raw 输出解码：把小端 uint16 / uint8 样本转换为 value * scale 的 float。
+// 所有内核都以 (float)value * scale 计算，与标量实现逐位一致。
+// count 为样本数，可一次传入多帧连续数据。src/dst 无对齐要求。
+typedef void (*cava_decode_fn)(const uint8_t *src, float *dst, size_t count, float scale);
+
+enum cava_simd_level {
+    CAVA_SIMD_SCALAR = 0,
+    CAVA_SIMD_SSE2,
+    CAVA_SIMD_AVX2,
+    CAVA_SIMD_AVX512,
+    CAVA_SIMD_NEON,
+};
+
+struct cava_decoder {
+    int level;           // enum cava_simd_level
+    const char *name;
+    cava_decode_fn u16;  // 2 字节小端样本
+    cava_decode_fn u8;   // 1 字节样本
+    // 逆序写出（第 i 个样本写到 dst[count - 1 - i]），用于 cava 立体声输出中倒序排列的左声道。
+    // count 应为单个声道的样本数
+    cava_decode_fn u16_rev;
+    cava_decode_fn u8_rev;
+};
+
+// 运行时检测 CPU，返回可用的最快内核（结果缓存，线程安全）
+const struct cava_decoder *cava_decoder_select(void);
+
+// 返回指定级别的内核；当前 CPU 或编译目标不支持时返回 nullptr
+const struct cava_decoder *cava_decoder_get(int level);
@@ -3,13 +3,141 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #define CAVA_BARS_NUMBER 128
+#define CAVA_FRAMERATE 65        // cava 默认帧率
+#define CAVA_FRAMERATE_MAX 999
 
 enum cava_status {
     CAVA_OK = 0,
     CAVA_ERR = -1,
 };
 
+// 环形缓冲模式
+enum cava_ring_mode {
+    CAVA_RING_QUEUE = 0,   // SPSC 队列：按序保留 ring_capacity 帧，满时丢弃新帧
+    CAVA_RING_LATEST = 1,  // 三缓冲邮箱：排空管道，只发布最新的完整帧（latest-wins）
+    CAVA_RING_BROADCAST = 2, // 广播：按序发布每一帧并覆盖最旧的槽位，从不等待消费者；
+                             // 任意多个 cava_cursor 各自独立读取（见下方游标接口）
+};
+
+// 环形缓冲中每个样本的存储格式
+enum cava_sample_format {
+    CAVA_SAMPLE_FLOAT = 0,  // 归一化到 [0, 1] 的 float
+    CAVA_SAMPLE_RAW = 1,    // cava 原样输出的 uint16_t（16bit）或 uint8_t（8bit），逐字节复制、不做转换；
+                            // 立体声时保持 cava 的顺序：左声道 lane 为高频在前，右声道低频在前。
+                            // 只能经 peek_raw 读取，归一化与左声道翻转留给使用者（例如作为 R16UI/R8UI 纹理在着色器中处理）
+};
+
+// 读取线程从 cava 取数据的方式
+enum cava_backend {
+    CAVA_BACKEND_READ = 0,       // poll + read()
+    CAVA_BACKEND_IO_URING = 1,   // io_uring READ_FIXED 读入注册缓冲；未编译或内核不支持时回退到 read()
+};
+
+struct cava_reader_options {
+    const char *bit_format;   // "16bit" or "8bit"
+    size_t bars_number;       // number of bars (per channel)
+    int channels;             // 1 = mono，2 = stereo：每帧依次存放左、右两条 lane，各 bars_number 个 float，均为低频在前
+    size_t ring_capacity;     // CAVA_RING_QUEUE / CAVA_RING_BROADCAST 的帧数（向上取 2 的幂）；邮箱模式忽略
+    int ring_mode;            // enum cava_ring_mode
+    size_t pipe_size;         // 非 0 时用 F_SETPIPE_SZ 调整 cava 管道容量（字节，内核按页取整）
+    const char *fifo_path;    // 非空时 cava 的 raw_target 指向该 FIFO（不存在则创建），不再经由 stdout
+    int backend;              // enum cava_backend
+    int respawn;              // 非 0 时 cava 退出后自动重启（环形缓冲与消费者接口保持不变）
+    unsigned restart_delay_ms;     // 首次重启前的等待，之后每次翻倍
+    unsigned restart_delay_max_ms; // 退避上限；新 cava 送出数据后退避复位
+    // 读取线程的调度（见 thread-sched.hpp）。实时策略无权限（无 CAP_SYS_NICE 且 RLIMIT_RTPRIO 不足）时
+    // 回退到 sched_nice；结果打印到 stderr，调度延迟见 cava_reader_stats。cava 子进程不继承这些设置
+    int sched_policy;         // SCHED_OTHER（默认，不改）/ SCHED_FIFO / SCHED_RR
+    int sched_priority;       // 实时优先级 1..99
+    int sched_nice;           // 回退时的 nice 值，0 表示不改
+    uint64_t cpu_affinity;    // 读取线程绑定的 CPU 位掩码（CPU 0..63），0 表示不改
+    int sample_format;        // enum cava_sample_format
+    int threadless;           // 非 0：不创建读取线程，调用者在自己的事件循环里 poll cava_reader_fd()
+                              // 并调用 cava_reader_service()；backend 与 sched_* 选项被忽略
+    unsigned framerate;       // cava 的初始帧率（1..CAVA_FRAMERATE_MAX，0 表示 CAVA_FRAMERATE），运行中可用 cava_reader_set_framerate 修改
+};
+
+// 共享内存环形缓冲布局（memfd，见 cava_reader_shm_fd）：
+//   cava_shm_header | cava_shm_slot[slot_count] | samples frames[slot_count][bars]
+// 立体声时每帧的 bars 个样本分为 channels 条等长 lane（左、右）。
+// 样本为 float，或 CAVA_SAMPLE_RAW 时为 sample_bytes 字节的原始整数（左声道 lane 高频在前）。
+// 各段偏移见 header，均按 64 字节对齐。其他进程可只读 mmap 该 fd，
+// 按 seqlock 协议读取：读 seq（偶数才有效）-> 复制帧 -> 再读 seq，不变则数据一致。
+// latest_slot/published 指向最近发布的帧；第 i 个发布的帧（从 0 计）位于槽位 i % slot_count，
+// 其 slot.index == i，据此判断槽位是否已被更新的帧覆盖。
+// notify 在每次发布后递增，等待者可对其 futex 等待（waiters 非 0 时生产者才 FUTEX_WAKE）。
+// 标为 atomic 的字段由生产者并发修改，必须用 GCC/Clang 的 __atomic 内建函数访问
+// （C++ 中同样适用）：published、slot.seq 用 __atomic_load_n(..., __ATOMIC_ACQUIRE)，
+// 复制帧后先 __atomic_thread_fence(__ATOMIC_ACQUIRE) 再重读 seq；其余 atomic 字段可用 __ATOMIC_RELAXED；
+// 修改 waiters 用 __atomic_fetch_add/__atomic_fetch_sub(..., __ATOMIC_SEQ_CST)。其他字段在创建后不再改变。
+#define CAVA_SHM_MAGIC 0x41564143u   // "CAVA"
+#define CAVA_SHM_VERSION 5u
+
+struct cava_shm_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t bars;                        // samples per frame
+    uint32_t slot_count;
+    uint32_t slots_offset;                // offset of cava_shm_slot[slot_count]
+    uint32_t data_offset;                 // offset of the frame payload
+    uint32_t latest_slot;                 // atomic: slot of the most recently published frame
+    uint32_t channels;                    // lanes per frame (bars / channels floats each)
+    uint64_t published;                   // atomic: total frames published
+    uint32_t sample_format;               // enum cava_sample_format
+    uint32_t sample_bytes;                // bytes per sample: 4 (float), 2 or 1 (raw)
+    uint32_t notify;                      // atomic: futex word, bumped after every publish
+    uint32_t waiters;                     // atomic: consumers blocked on notify
+};
+
+struct cava_shm_slot {
+    uint64_t seq;                         // atomic: seqlock, odd while the producer writes the slot
+    uint64_t frame_seq;                   // atomic: see cava_frame_info::seq
+    uint64_t arrival_ns;                  // atomic: see cava_frame_info::arrival_ns
+    uint64_t index;                       // atomic: publish index of the frame in this slot
+};
+
+// 每帧的时间信息
+struct cava_frame_info {
+    uint64_t seq;          // 自启动以来从 cava 收到的完整帧序号（从 0 开始，含被丢弃/跳过的帧），
+                           // 相邻两次取到的帧序号差 > 1 即表示中间有丢帧
+    uint64_t arrival_ns;   // CLOCK_MONOTONIC：包含该帧的 read() 返回的时间。同一次 read 取到的多帧时间相同
+};
+
+// 读取器健康计数（cava_reader_stats）。每个字段单独原子读取，字段之间不保证是同一时刻的快照；
+// 计数在 start 时清零，cava 重启时保留。用于区分卡顿来自 cava（无数据/重启）、
+// 管道（短读、EINTR）还是渲染端跟不上（丢帧、环形缓冲高水位）。
+struct cava_reader_stats {
+    uint64_t frames_received;      // 从 cava 收到的完整帧
+    uint64_t frames_published;     // 写入环形缓冲/邮箱并通知消费者的帧
+    uint64_t frames_consumed;      // 被 pop/peek 取走的帧
+    uint64_t frames_dropped;       // 队列模式：环满时丢弃的帧；广播模式：一次读到超过容量的帧时未发布的旧帧
+    uint64_t frames_superseded;    // 邮箱模式：被更新帧取代、消费者没有看到的帧
+    uint64_t reads;                // 唤醒读取的次数（一次可能取到多帧）
+    uint64_t short_reads;          // 读取结束在帧中间、需要携带半帧到下一次读取的次数
+    uint64_t eintr_retries;        // poll/read 被信号打断后重试的次数
+    uint64_t decode_ns_last;       // 最近一批解码的平均每帧耗时（纳秒）
+    uint64_t decode_ns_avg;        // 启动以来平均每帧解码耗时（纳秒）
+    uint64_t ring_capacity;        // 环形缓冲槽位数（邮箱模式为 3）
+    uint64_t ring_high_water;      // 发布时观察到的未读帧数最大值（含消费者持有的视图）；广播模式为 0
+    uint64_t ns_since_last_frame;  // 距最近一次发布的时间；尚未发布过任何帧时为 UINT64_MAX
+    uint64_t frame_age_ns;         // 同 cava_reader_frame_age_ns
+    uint64_t restarts;             // 同 cava_reader_restarts
+    uint64_t downtime_ns;          // 同 cava_reader_downtime_ns
+    uint64_t paused_ns;            // 同 cava_reader_paused_ns
+    uint64_t framerate;            // 同 cava_reader_framerate
+    uint64_t reloads;              // 为修改帧率向 cava 发送 SIGUSR1 的次数
+    uint64_t sched_wait_ns;        // 读取线程可运行但等待 CPU 的累计时间（schedstat，不可用时为 0）
+    uint64_t sched_slices;         // 读取线程获得 CPU 的次数；两次采样的 wait 差 / slices 差即平均调度延迟
+};
+
+// 填充默认值：16bit、CAVA_BARS_NUMBER、单声道、容量 16、队列模式、保持默认管道大小、float 样本、CAVA_FRAMERATE
+void cava_reader_options_init(struct cava_reader_options *opts);
+
 // 启动 cava 读取线程
 // bit_format: "16bit" or "8bit"
 // bars_number: number of bars (usually CAVA_BARS_NUMBER)
@@ -17,16 +145,204 @@ enum cava_status {
 // Returns CAVA_OK on success, CAVA_ERR on failure.
 int cava_reader_start(const char *bit_format, size_t bars_number, size_t ring_capacity);
 
+// 按 options 启动读取线程，其余同 cava_reader_start
+int cava_reader_start_ex(const struct cava_reader_options *opts);
+
 // 停止并 join 读取线程（阻塞直到清理完成）
 void cava_reader_stop(void);
 
-// 非阻塞尝试读取一帧数据（长度 == bars_number passed to start）。
-// out_buf must point to an array of at least bars_number floats.
+// 非阻塞尝试读取一帧数据（长度 == bars_number * channels passed to start）。
+// out_buf must point to an array of at least bars_number * channels floats.
 // Returns 1 if a frame was read, 0 if no frame available, -1 on error.
 int cava_reader_try_pop(float *out_buf, size_t max_len);
 
-// 查询启动时使用的 bars_number（只读）
+// 同 cava_reader_try_pop，另外在 info（可为 nullptr）中返回帧序号与到达时间
+int cava_reader_try_pop_ex(float *out_buf, size_t max_len, struct cava_frame_info *info);
+
+// 批量读取：一次取走至多 max_len / (bars_number * channels) 帧，按到达顺序连续写入 out_buf，
+// infos（可为 nullptr）须能容纳同样多的条目。返回读取的帧数（0 表示没有新帧），-1 表示出错。
+// 队列模式下只做一次索引同步与至多两次 memcpy；其他模式每次至多返回 1 帧。
+int cava_reader_try_pop_n(float *out_buf, size_t max_len, struct cava_frame_info *infos);
+
+// 零拷贝读取：取下一帧并返回指向环形缓冲槽位的只读视图（bars_number * channels 个 float）。
+// 有新帧时先释放之前持有的视图再返回新视图；没有新帧时返回 0，已持有的视图保持有效。
+// 视图在 cava_reader_release()、下一次成功的 peek 或 try_pop 之前一直有效，
+// 期间读取线程不会覆写该槽位（队列模式下它占用一个槽位）。
+// Returns 1 if a view was returned, 0 if no new frame, -1 on error.
+int cava_reader_peek(const float **frame);
+
+// 同 cava_reader_peek，另外在 info（可为 nullptr）中返回帧序号与到达时间
+int cava_reader_peek_ex(const float **frame, struct cava_frame_info *info);
+
+// 同 cava_reader_peek_ex，但返回存储格式的原始视图（bars_number * channels 个样本，
+// 每个 cava_reader_sample_bytes 字节），任何 sample_format 下都可用。
+// CAVA_SAMPLE_RAW 模式下 float 接口（peek、try_pop、wait_pop）返回 -1，只能用此函数。
+int cava_reader_peek_raw(const void **frame, struct cava_frame_info *info);
+
+// 释放 cava_reader_peek 持有的视图（未持有时无操作）
+void cava_reader_release(void);
+
+// 共享环形缓冲的 memfd（只读映射见 cava_shm_header），未运行或回退到匿名映射时返回 -1。
+// fd 归 reader 所有，可经 SCM_RIGHTS 传给其他进程；cava_reader_stop 时关闭。
+int cava_reader_shm_fd(void);
+
+// 共享映射的总字节数
+size_t cava_reader_shm_size(void);
+
+// 阻塞读取一帧，直到有帧、超时或读取线程停止。
+// timeout_ns < 0 表示无限等待，0 等价于 cava_reader_try_pop。
+// 空闲时阻塞在 cava_reader_fd() 上，不占用 CPU。与 cava_reader_fd() 共用同一计数，
+// 同一时刻只应有一个消费者等待。无线程模式下等待期间自行调用 cava_reader_service。
+// Returns 1 if a frame was read, 0 on timeout or when the reader has stopped, -1 on error.
+int cava_reader_wait_pop(float *out_buf, size_t max_len, int64_t timeout_ns);
+
+// 累计跳过的帧数：队列模式下为环满时丢弃的帧，
+// 邮箱模式下为排空管道时被更新帧覆盖、以及消费者未及读取就被替换的帧
+uint64_t cava_reader_skipped_frames(void);
+
+// 最近一次 pop/peek 的帧从读出管道到被消费者取走经过的时间（纳秒）
+uint64_t cava_reader_frame_age_ns(void);
+
+// cava 子进程被重启的次数
+uint64_t cava_reader_restarts(void);
+
+// 累计无数据时间（纳秒）：从检测到 cava 退出到重启后的 cava 送出第一批数据，
+// 当前仍在重启中时包含进行中的这一段
+uint64_t cava_reader_downtime_ns(void);
+
+// 暂停/恢复 cava：向子进程发送 SIGSTOP/SIGCONT。暂停期间 cava 不再采集与分析音频，
+// 读取线程（或无线程模式的事件循环）在空管道上阻塞，不占用 CPU；暂停期间重启的 cava 也立即被暂停。
+// 恢复不需要重新启动 cava（没有音频采集与配置解析的冷启动），下一帧在一个 cava 帧周期内到达；
+// 管道中暂停前写入的帧仍会先被读出。可在任意线程调用，重复调用无副作用。未运行时返回 CAVA_ERR
+int cava_reader_pause(void);
+int cava_reader_resume(void);
+
+// 是否处于暂停状态（1/0）
+int cava_reader_paused(void);
+
+// 累计暂停时间（纳秒），当前仍在暂停时包含进行中的这一段
+uint64_t cava_reader_paused_ns(void);
+
+// 运行中修改 cava 的帧率（限制在 1..CAVA_FRAMERATE_MAX）：改写内存中的配置并向 cava 发送 SIGUSR1，
+// cava 重新读取配置，不重启进程，柱数与帧格式不变，环形缓冲与消费者不受影响。
+// cava 在信号后重新打开音频输入，会有一两帧的间隙，autosens 也重新开始，不宜频繁调用。
+// 尚未送出数据的 cava 可能还没有安装信号处理函数，此时只改写配置，待其送出第一批数据后再通知；
+// 之后重启的 cava 直接以新帧率启动。帧率未变化时什么也不做。可在任意线程调用，未运行时返回 CAVA_ERR
+int cava_reader_set_framerate(unsigned framerate);
+
+// 当前配置的帧率（未运行时为 0）
+unsigned cava_reader_framerate(void);
+
+// 读取健康计数，未运行（从未启动）时全部为 0。可在任意线程调用（sched_* 字段读取 /proc）。
+// Returns CAVA_OK, or CAVA_ERR if out is null.
+int cava_reader_stats(struct cava_reader_stats *out);
+
+// 查询启动时使用的 bars_number（只读，每声道）
 size_t cava_reader_bars_number(void);
 
-// 查询当前运行状态：1=running, 0=stopped
-int cava_reader_running(void);
\ No newline at end of file
+// 声道数（1 或 2）。每帧共 bars_number * channels 个 float，pop/peek 的缓冲长度按此计算
+size_t cava_reader_channels(void);
+
+// 启动时使用的 enum cava_sample_format
+int cava_reader_sample_format(void);
+
+// 环形缓冲中每个样本的字节数：float 为 4，原始样本为 2（16bit）或 1（8bit）
+size_t cava_reader_sample_bytes(void);
+
+// 查询当前运行状态：1=running, 0=stopped。
+// 启用 respawn 时，cava 重启期间仍为 1
+int cava_reader_running(void);
+
+// 就绪通知 fd（eventfd，非阻塞）：读取线程每发布一帧或退出时变为可读。
+// 可放入 poll/epoll；消费者读取 8 字节清零计数后再调用 cava_reader_try_pop。
+// 无线程模式下返回一个 epoll fd（包含 cava 的非阻塞数据 fd、子进程 pidfd 与重启定时器），
+// 在 cava 重启之间保持不变；可读时调用 cava_reader_service()，不需要读取它。
+// 未运行时返回 -1。fd 归 reader 所有，cava_reader_stop 时关闭。
+int cava_reader_fd(void);
+
+// 无线程模式（opts.threadless）：在调用线程上完成读取线程的工作，不阻塞。
+// 读出管道中已有的数据，按 ring_mode 发布其中的完整帧，并处理 cava 的退出与退避重启；
+// 之后可在同一线程 peek/try_pop，不经过跨线程交接，也没有每帧一次的 eventfd 唤醒。
+// 返回本次发布的帧数（0 表示没有新帧）；不是无线程模式，或 cava 已退出且不再重启时返回 -1。
+// 同一个 reader 只应由一个线程调用（它就是生产者）。
+int cava_reader_service(void);
+// ---------------------------------------------------------------------------
+// 多实例句柄接口：每个 cava_stream 拥有独立的 cava 子进程、读取线程与环形缓冲，
+// 可同时运行多个（例如每个显示器一个，柱数不同）。上面的 cava_reader_* 函数
+// 操作进程内的一个默认实例。各函数语义与同名 cava_reader_* 函数一致。
+// 每个 stream 只应有一个消费者线程。
+typedef struct cava_stream cava_stream;
+
+// 按 opts 启动一个新的 stream，失败返回 nullptr
+cava_stream *cava_stream_start(const struct cava_reader_options *opts);
+
+// 停止 cava、回收读取线程并释放 stream（nullptr 时无操作）
+void cava_stream_stop(cava_stream *stream);
+
+int cava_stream_try_pop(cava_stream *stream, float *out_buf, size_t max_len, struct cava_frame_info *info);
+int cava_stream_try_pop_n(cava_stream *stream, float *out_buf, size_t max_len, struct cava_frame_info *infos);
+int cava_stream_wait_pop(cava_stream *stream, float *out_buf, size_t max_len, int64_t timeout_ns);
+int cava_stream_peek(cava_stream *stream, const float **frame, struct cava_frame_info *info);
+int cava_stream_peek_raw(cava_stream *stream, const void **frame, struct cava_frame_info *info);
+void cava_stream_release(cava_stream *stream);
+
+int cava_stream_fd(const cava_stream *stream);
+int cava_stream_service(cava_stream *stream);
+int cava_stream_running(const cava_stream *stream);
+size_t cava_stream_bars_number(const cava_stream *stream);
+size_t cava_stream_channels(const cava_stream *stream);
+int cava_stream_sample_format(const cava_stream *stream);
+size_t cava_stream_sample_bytes(const cava_stream *stream);
+uint64_t cava_stream_skipped_frames(const cava_stream *stream);
+uint64_t cava_stream_frame_age_ns(const cava_stream *stream);
+uint64_t cava_stream_restarts(const cava_stream *stream);
+uint64_t cava_stream_downtime_ns(const cava_stream *stream);
+int cava_stream_pause(cava_stream *stream);
+int cava_stream_resume(cava_stream *stream);
+int cava_stream_paused(const cava_stream *stream);
+uint64_t cava_stream_paused_ns(const cava_stream *stream);
+int cava_stream_set_framerate(cava_stream *stream, unsigned framerate);
+unsigned cava_stream_framerate(const cava_stream *stream);
+int cava_stream_stats(const cava_stream *stream, struct cava_reader_stats *out);
+int cava_stream_shm_fd(const cava_stream *stream);
+size_t cava_stream_shm_size(const cava_stream *stream);
+
+// ---------------------------------------------------------------------------
+// 广播游标（仅 CAVA_RING_BROADCAST）：每个游标独立地按发布顺序读取全部帧，
+// 例如渲染、录制、统计、IPC 转发各持有一个。读取是无锁的 seqlock 复制，不写任何共享状态，
+// 生产者从不等待游标；落后超过 ring_capacity 帧的游标跳到最旧的仍有效的帧，
+// 被跳过的帧计入 cava_cursor_missed。
+// 一个游标只应在一个线程中使用；不同游标可在不同线程并发使用。
+// 游标必须在对应的 reader/stream 停止之前关闭。
+// 广播模式下单消费者接口 try_pop/wait_pop 经由内部游标工作，peek 不可用（返回 -1）。
+typedef struct cava_cursor cava_cursor;
+
+// 在运行中的广播模式 reader/stream 上打开游标，从下一个发布的帧开始读取。
+// 不是广播模式或未运行时返回 nullptr
+cava_cursor *cava_reader_cursor_open(void);
+cava_cursor *cava_stream_cursor_open(cava_stream *stream);
+
+void cava_cursor_close(cava_cursor *cursor);
+
+// 复制游标的下一帧（bars_number * channels 个 float）到 out_buf 并前进。
+// Returns 1 if a frame was read, 0 if the cursor is caught up, -1 on error
+// (short buffer, or CAVA_SAMPLE_RAW: use cava_cursor_read_raw).
+int cava_cursor_read(cava_cursor *cursor, float *out_buf, size_t max_len, struct cava_frame_info *info);
+
+// 同 cava_cursor_read，按存储格式复制（bars_number * channels * sample_bytes 字节）
+int cava_cursor_read_raw(cava_cursor *cursor, void *out, size_t max_bytes, struct cava_frame_info *info);
+
+// 阻塞直到游标有可读的帧（返回 1）、超时或 reader 停止（返回 0）。
+// timeout_ns < 0 表示无限等待。在共享头的 futex 上睡眠，各游标互不影响。
+// 无线程模式下由调用 service 的线程发布帧，该线程自己不应在此等待
+int cava_cursor_wait(const cava_cursor *cursor, int64_t timeout_ns);
+
+// 跳到最新发布的帧（只关心最新一帧的消费者，例如渲染），跳过的帧计入 missed
+void cava_cursor_seek_latest(cava_cursor *cursor);
+
+// 被覆盖或跳过、该游标没有读到的帧数
+uint64_t cava_cursor_missed(const cava_cursor *cursor);
+
+#ifdef __cplusplus
+}
+#endif
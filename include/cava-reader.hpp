@@ -0,0 +1,245 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <limits.h>
+#include <sched.h>
+#include <sys/types.h>
+
+#include "cava-input.hpp"
+#include "spsc-ring.hpp"
+#include "thread-sched.hpp"
+#include "uring-reader.hpp"
+
+struct cava_decoder;
+
+// 广播模式（CAVA_RING_BROADCAST）下一个消费者的读取位置，只由该消费者修改
+struct BroadcastCursor {
+    uint64_t next = 0;     // 下一个要读取的发布序号
+    uint64_t missed = 0;   // 读到之前就被生产者覆盖的帧数
+};
+
+// 一个 cava 频谱流：拥有自己的 cava 子进程、读取线程、共享环形缓冲与就绪 eventfd。
+// 多个实例可以同时运行（例如不同显示器使用不同柱数）。
+// pop/peek/release/wait_pop 是单消费者接口，应只在同一个消费者线程调用；
+// 广播模式下另有任意多个 BroadcastCursor，各自只在自己的线程使用，cursor_* 方法互不干扰。
+// 各方法语义与 cava-input.hpp 中同名的 cava_reader_* 函数一致。
+class CavaReader {
+public:
+    CavaReader() = default;
+    ~CavaReader();
+    CavaReader(const CavaReader &) = delete;
+    CavaReader &operator=(const CavaReader &) = delete;
+
+    int start(const cava_reader_options *opts);
+    void stop();
+    int service();
+
+    int try_pop(float *out_buf, size_t max_len, cava_frame_info *info = nullptr);
+    int try_pop_n(float *out_buf, size_t max_len, cava_frame_info *infos = nullptr);
+    int wait_pop(float *out_buf, size_t max_len, int64_t timeout_ns);
+    int peek(const float **frame, cava_frame_info *info = nullptr);
+    int peek_raw(const void **frame, cava_frame_info *info = nullptr);
+    void release();
+
+    // 广播模式的游标读取：cursor_read 复制一帧（slot_bytes 字节）到 out
+    void cursor_open(BroadcastCursor *cursor) const;
+    int cursor_read(BroadcastCursor *cursor, void *out, size_t out_bytes, cava_frame_info *info) const;
+    int cursor_wait(const BroadcastCursor *cursor, int64_t timeout_ns) const;
+    void cursor_seek_latest(BroadcastCursor *cursor) const;
+    size_t frame_bytes() const { return slot_bytes; }
+    int mode() const { return ring_mode; }
+
+    int fd() const { return threadless ? service_fd : ready_fd; }
+    int shm_fd() const { return shm_memfd; }
+    size_t shm_size() const { return shm_bytes; }
+    size_t bars_number() const { return bars; }
+    size_t channel_count() const { return channels; }
+    int sample_format_in_use() const { return sample_format; }
+    size_t sample_size() const { return sample_bytes; }
+    bool running() const { return is_running.load(std::memory_order_acquire) != 0; }
+    uint64_t skipped_frames() const { return skipped.load(std::memory_order_relaxed); }
+    uint64_t frame_age_ns() const { return last_frame_age_ns.load(std::memory_order_relaxed); }
+    uint64_t restarts() const { return restart_count.load(std::memory_order_relaxed); }
+    uint64_t downtime_ns() const;
+    int pause();
+    int resume();
+    bool paused() const { return paused_since_ns.load(std::memory_order_relaxed) != 0; }
+    uint64_t paused_ns() const;
+    int set_framerate(unsigned fps);
+    unsigned framerate() const { return config_rate.load(std::memory_order_relaxed); }
+    void stats(struct cava_reader_stats *out) const;
+
+private:
+    // 共享环形缓冲
+    int create_shared_ring(size_t slots, size_t samples_per_slot);
+    void destroy_shared_ring();
+    void slots_begin_write(size_t first, size_t count);
+    void slots_end_write(size_t first, size_t count, uint64_t first_seq, uint64_t arrival_ns);
+    // 子进程与 FIFO
+    int open_fifo(const char *path);
+    void close_keepalive();
+    int spawn_child();
+    void reap_child();
+    void release_resources();
+    // 读取线程（同时负责监督 cava 子进程）
+    void thread_main();
+    bool wait_backoff(uint64_t delay_ns);
+    void note_cava_down(uint64_t delay_ns);
+    void loop_read();
+    void publish_available(uint64_t arrival_ns);
+    void publish_queue(size_t frames, uint64_t arrival_ns);
+    void publish_latest(size_t frames, uint64_t arrival_ns);
+    void publish_broadcast(size_t frames, uint64_t arrival_ns);
+    void notify_cursors();
+    bool prepare_read_buffer(size_t chunk_size);
+    bool read_available(std::vector<uint8_t> &buffer, size_t *have);
+    bool read_available_uring(std::vector<uint8_t> &buffer, size_t *have);
+    void note_data_arrived();
+    // 无线程模式：service() 在调用者线程上扮演读取线程
+    bool service_watch_child();
+    bool service_read();
+    void service_child_exited();
+    void service_respawn();
+    void decode_frames(const uint8_t *src, float *dst, size_t frames) const;
+    void store_frames(const uint8_t *src, uint8_t *dst, size_t frames) const;
+    void note_decoded(size_t frames, uint64_t elapsed_ns);
+    void note_published(size_t frames, size_t occupancy, uint64_t now_ns);
+    void signal_ready();
+    // 消费者
+    void take_view(size_t slot_index, cava_frame_info *info);
+
+    std::thread thread;
+    std::atomic<int> is_running{0};
+    size_t bars = CAVA_BARS_NUMBER;           // per channel
+    size_t channels = 1;
+    size_t frame_floats = CAVA_BARS_NUMBER;   // bars * channels: one ring slot
+    size_t bytes_per_sample = 2;          // as cava writes them
+    float scale = 1.0f / 65535.0f;        // multiply-by-reciprocal normalisation
+    int sample_format = CAVA_SAMPLE_FLOAT;
+    size_t sample_bytes = sizeof(float);  // per sample in the ring
+    size_t slot_bytes = CAVA_BARS_NUMBER * sizeof(float);
+    const cava_decoder *decoder = nullptr;
+    int ring_mode = CAVA_RING_QUEUE;
+
+    // 共享映射：header | slot headers | 帧数据
+    uint8_t *shm_base = nullptr;
+    size_t shm_bytes = 0;
+    int shm_memfd = -1;
+    cava_shm_header *shm_hdr = nullptr;
+    cava_shm_slot *shm_slots = nullptr;
+
+    // frame slots, contiguous in the shared mapping (ring_capacity * slot_bytes)
+    uint8_t *ring_data = nullptr;
+    size_t ring_capacity = 0;             // number of frames
+    size_t ring_mask = 0;
+    // CAVA_RING_QUEUE: SPSC indices over ring_data, one item per frame slot
+    SpscRing<uint8_t> queue;
+    bool view_held = false;               // consumer holds a peek view of the oldest slot
+
+    // latest-wins mailbox (CAVA_RING_LATEST): ring_data holds 3 slots.
+    // The producer owns mb_back, the consumer owns mb_front, and `mailbox`
+    // holds the middle slot index plus MAILBOX_DIRTY when it carries an unread frame.
+    std::atomic<uint32_t> mailbox{1};
+    uint32_t mb_back = 0;
+    uint32_t mb_front = 2;
+
+    // broadcast (CAVA_RING_BROADCAST): the producer overwrites slots in publish
+    // order and never looks at consumers; try_pop/wait_pop read through own_cursor
+    BroadcastCursor own_cursor;
+
+    std::atomic<uint64_t> skipped{0};
+    std::atomic<uint64_t> last_frame_age_ns{0};
+    // health counters for stats(); written by the reader thread, except
+    // stat_consumed which belongs to the consumer
+    std::atomic<uint64_t> stat_received{0};
+    std::atomic<uint64_t> stat_published{0};
+    std::atomic<uint64_t> stat_consumed{0};
+    std::atomic<uint64_t> stat_reads{0};
+    std::atomic<uint64_t> stat_short_reads{0};
+    std::atomic<uint64_t> stat_eintr{0};
+    std::atomic<uint64_t> stat_decode_ns{0};       // total, over stat_decoded frames
+    std::atomic<uint64_t> stat_decoded{0};
+    std::atomic<uint64_t> stat_decode_ns_last{0};  // per frame, last batch
+    std::atomic<uint64_t> stat_high_water{0};
+    std::atomic<uint64_t> last_publish_ns{0};      // 0 until the first publish
+
+    // reader thread scheduling, applied by the thread itself; its tid is
+    // published for the schedstat counters in stats()
+    ThreadSched sched;
+    std::atomic<pid_t> thread_tid{0};
+    // CPU mask cava is put back on when the reader thread is pinned, so the
+    // child neither inherits nor competes for the reader's CPUs
+    bool child_affinity_set = false;
+    cpu_set_t child_affinity;
+    uint64_t rx_seq = 0;                  // complete frames received from cava (reader thread only)
+
+    // reader thread: raw cava bytes plus a carried partial frame, and the
+    // optional io_uring backend reading into it
+    std::vector<uint8_t> read_buffer;
+    size_t read_have = 0;                 // bytes in read_buffer not yet published
+    int backend = CAVA_BACKEND_READ;
+    bool use_uring = false;
+    UringReader uring;
+    bool uring_read_pending = false;
+    bool uring_child_exited = false;
+
+    // child process pid, its pidfd (-1 if pidfd_open is unavailable) and the fd
+    // cava writes frames to (stdout pipe or FIFO). Owned by the reader thread
+    // once it is started; start() and release_resources() touch them only while
+    // the thread is not running.
+    pid_t child_pid = -1;
+    int child_pidfd = -1;
+    int cava_data_fd = -1;
+    size_t pipe_size = 0;                 // F_SETPIPE_SZ applied to every spawned cava's pipe
+    int config_fd = -1;                   // in-memory config, passed to cava as /proc/self/fd/N
+    size_t config_rate_offset = 0;        // offset of the fixed-width framerate value in it
+    char cava_exe[PATH_MAX] = {0};        // cava resolved against $PATH at start
+    // FIFO transport: cava's raw_target points at fifo_path instead of stdout.
+    // fifo_keepalive_fd is a write end we hold for cava's lifetime, so reads
+    // block instead of returning EOF before cava opens the FIFO or while it
+    // reopens it on a reload; its exit is seen through the pidfd. Without a
+    // pidfd it is dropped at cava's first data and EOF marks the exit.
+    char fifo_path[256] = {0};
+    bool fifo_created = false;
+    int fifo_keepalive_fd = -1;
+    // eventfd signalled whenever a frame is published (or the reader exits)
+    int ready_fd = -1;
+    // eventfd stop() uses to interrupt the reader thread's poll / backoff wait
+    int wake_fd = -1;
+    // threadless mode: no reader thread and no ready/wake eventfds. The caller
+    // polls service_fd (epoll over the data fd, the pidfd and respawn_timer_fd)
+    // and runs service(), which reads, publishes and supervises cava in its place
+    bool threadless = false;
+    int service_fd = -1;
+    int respawn_timer_fd = -1;
+    uint64_t service_delay_ns = 0;        // backoff before the next respawn
+    uint64_t service_rx_at_spawn = 0;     // rx_seq when the current cava was spawned
+
+    // supervisor: respawn cava with exponential backoff when it exits
+    bool respawn = true;
+    uint64_t restart_delay_ns = 0;
+    uint64_t restart_delay_max_ns = 0;
+    std::atomic<uint64_t> restart_count{0};
+    std::atomic<uint64_t> downtime_total_ns{0};
+    std::atomic<uint64_t> down_since_ns{0};  // non-zero while cava is down
+
+    // pause()/resume() signal cava from the consumer's thread while the reader
+    // thread may be reaping or respawning it. signal_pid is the pid that is
+    // safe to signal: it is cleared under child_mutex before waitpid can free
+    // the pid for reuse, and a cava spawned while paused is stopped under it.
+    std::mutex child_mutex;
+    pid_t signal_pid = -1;
+    std::atomic<uint64_t> paused_total_ns{0};
+    std::atomic<uint64_t> paused_since_ns{0};  // non-zero while paused
+    // set_framerate() rewrites the config in place and sends SIGUSR1, which
+    // kills a cava that has not installed its handlers yet. signal_ready_child
+    // is set once the current cava has delivered data; a change made before
+    // that is sent on the first data instead (child_rate differs).
+    std::atomic<unsigned> config_rate{0};  // rate in the config (written under child_mutex)
+    unsigned child_rate = 0;               // rate the current cava last loaded (under child_mutex)
+    std::atomic<bool> signal_ready_child{false};
+    std::atomic<uint64_t> reload_count{0};
+};
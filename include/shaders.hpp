@@ -7,6 +7,100 @@ const char *vertex_shader_source = R"(
     }
 )";
 
+// GPU 样条：每个条带顶点由 gl_VertexID 重建，控制点与切线来自 RG32F 纹理
+// 偶数顶点贴底边 (y = -1)，奇数顶点位于曲线上，与 CPU 路径的顶点顺序一致
+// 立体声时每个声道一个实例，纹理第 gl_InstanceID 行为该声道的控制点；
+// mirrored 非 0 时左声道画在左半、右声道画在右半，低频在中间，否则两条曲线叠加铺满全宽
+const char *spline_vertex_shader_source = R"(
+    #version 320 es
+    precision highp float;
+    uniform highp sampler2D controlPoints;
+    uniform int pointCount;
+    uniform int pointsPerSegment;
+    uniform int mirrored;
+    void main() {
+        int steps = pointsPerSegment + 1;
+        int column = gl_VertexID / 2;
+        int segment = min(column / steps, pointCount - 2);
+        float u = float(column - segment * steps) / float(steps);
+
+        vec2 p0 = texelFetch(controlPoints, ivec2(segment, gl_InstanceID), 0).rg;
+        vec2 p1 = texelFetch(controlPoints, ivec2(segment + 1, gl_InstanceID), 0).rg;
+        float u2 = u * u;
+        float u3 = u2 * u;
+        float h0 = 2.0 * u3 - 3.0 * u2 + 1.0;
+        float h1 = -2.0 * u3 + 3.0 * u2;
+        float h2 = u3 - 2.0 * u2 + u;
+        float h3 = u3 - u2;
+
+        float t = (float(segment) + u) / float(pointCount - 1);
+        float x = -1.0 + 2.0 * t;
+        if (mirrored != 0) {
+            x = gl_InstanceID == 0 ? -t : t;
+        }
+        float y = h0 * p0.x + h1 * p1.x + h2 * p0.y + h3 * p1.y;
+        if ((gl_VertexID & 1) == 0) {
+            y = -1.0;
+        }
+        gl_Position = vec4(x, y, 0.0, 1.0);
+    }
+)";
+
+// GPU 样条（原始样本）：纹理为 cava 原样输出的 R16UI/R8UI，每个声道一行；
+// cava 立体声的左声道为高频在前，firstLaneReversed 非 0 时第 0 行按反序读取。
+// 归一化、控制点与切线（与 CPU 端 compute_spline 相同的 cardinal 切线，末点切线为 0）都在着色器中完成，
+// CPU 不做任何 float 转换。其余与上面的 spline_vertex_shader_source 相同
+const char *spline_raw_vertex_shader_source = R"(
+    #version 320 es
+    precision highp float;
+    uniform highp usampler2D samples;
+    uniform float sampleScale;
+    uniform float tangentScale;
+    uniform int pointCount;
+    uniform int pointsPerSegment;
+    uniform int mirrored;
+    uniform int firstLaneReversed;
+
+    float point(int i) {
+        int column = (firstLaneReversed != 0 && gl_InstanceID == 0) ? pointCount - 1 - i : i;
+        return float(texelFetch(samples, ivec2(column, gl_InstanceID), 0).r) * sampleScale * 2.0 - 1.0;
+    }
+
+    float tangent(int i) {
+        if (i >= pointCount - 1) {
+            return 0.0;
+        }
+        return tangentScale * (point(i + 1) - point(max(i - 1, 0)));
+    }
+
+    void main() {
+        int steps = pointsPerSegment + 1;
+        int column = gl_VertexID / 2;
+        int segment = min(column / steps, pointCount - 2);
+        float u = float(column - segment * steps) / float(steps);
+
+        vec2 p0 = vec2(point(segment), tangent(segment));
+        vec2 p1 = vec2(point(segment + 1), tangent(segment + 1));
+        float u2 = u * u;
+        float u3 = u2 * u;
+        float h0 = 2.0 * u3 - 3.0 * u2 + 1.0;
+        float h1 = -2.0 * u3 + 3.0 * u2;
+        float h2 = u3 - 2.0 * u2 + u;
+        float h3 = u3 - u2;
+
+        float t = (float(segment) + u) / float(pointCount - 1);
+        float x = -1.0 + 2.0 * t;
+        if (mirrored != 0) {
+            x = gl_InstanceID == 0 ? -t : t;
+        }
+        float y = h0 * p0.x + h1 * p1.x + h2 * p0.y + h3 * p1.y;
+        if ((gl_VertexID & 1) == 0) {
+            y = -1.0;
+        }
+        gl_Position = vec4(x, y, 0.0, 1.0);
+    }
+)";
+
 const char *fragment_shader_source = R"(
     #version 320 es
     precision highp float;
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// cardinal spline 的 CPU 部分，两种渲染模式共用；不依赖 GL，便于单独做基准。
+// 顶点为 GL_SHORT 归一化坐标（int16_t），与 CPU 细分路径的顶点缓冲格式一致。
+
+static const float spline_tension = 0.5f;
+static const size_t spline_points_per_segment = 128;
+
+// 计算 n 个样本（[0, 1]）的控制点（映射到 [-1, 1]）与切线
+void compute_spline(const float *frame, size_t n, std::vector<float> &control_points, std::vector<float> &tangents);
+
+// 一条 lane 的三角带顶点数：每段 points_per_segment + 1 列，加上最后一个控制点，每列上下两个顶点
+size_t spline_strip_vertices(size_t n);
+
+// 把一条 lane 的三角带（x 从 x_begin 线性变化到 x_end）写到 out，每个顶点两个 int16_t，返回写入结束位置。
+// out 须能容纳 spline_strip_vertices(n) * 2 个值。control_points 与 tangents 是调用者持有的暂存，
+// 跨帧复用以免每帧分配
+int16_t *write_spline_strip(int16_t *out, const float *lane, size_t n, float x_begin, float x_end,
+                            std::vector<float> &control_points, std::vector<float> &tangents);
+
+// GPU 路径的上传数据：row 中交错写入 n 个 (控制点, 切线)，row 须能容纳 n * 2 个 float
+void pack_spline_points(const float *lane, size_t n, std::vector<float> &control_points,
+                        std::vector<float> &tangents, float *row);
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <string.h>
+#include <type_traits>
+#include <vector>
+
+// 单生产者/单消费者无锁环形队列（header-only）。
+// - head、tail 各占一个缓存行，生产者与消费者不会伪共享；
+// - 双方各自缓存对方的索引，只有缓存显示空间/数据不够时才重新读取对方的原子变量；
+// - 零拷贝：生产者经 write_slot 原地写入后 commit_write，消费者经 peek 原地读取后 commit_read；
+// - pop_n 一次取走多项，至多两次 memcpy（环绕前后各一段）。
+// 索引是单调递增的计数器（槽位 = 索引 & mask），容量个槽位全部可用。
+// 每项为 stride 个连续的 T（运行时确定，例如一帧 bars 个 float）；
+// 存储可以由调用者提供（例如共享内存），此时 SpscRing 只管理索引。
+template <typename T>
+class SpscRing {
+    static_assert(std::is_trivially_copyable<T>::value, "SpscRing items are copied with memcpy");
+
+public:
+    static constexpr size_t cache_line = 64;
+
+    SpscRing() = default;
+    SpscRing(const SpscRing &) = delete;
+    SpscRing &operator=(const SpscRing &) = delete;
+
+    // capacity 必须是 2 的幂，stride 为每项的 T 个数。storage 为 nullptr 时自行分配
+    // capacity * stride 个 T，否则使用调用者的存储（须比 ring 活得久）。
+    // 清空队列；只能在生产者、消费者都不访问时调用。
+    bool init(size_t capacity, size_t stride = 1, T *storage = nullptr) {
+        if (capacity == 0 || (capacity & (capacity - 1)) != 0 || stride == 0) return false;
+        if (storage) {
+            owned.clear();
+        } else {
+            owned.assign(capacity * stride, T());
+            storage = owned.data();
+        }
+        data = storage;
+        cap = capacity;
+        mask = capacity - 1;
+        item = stride;
+        reset();
+        return true;
+    }
+
+    // 清空队列（同 init，要求没有并发访问）
+    void reset() {
+        prod.head.store(0, std::memory_order_relaxed);
+        prod.tail_cache = 0;
+        cons.tail.store(0, std::memory_order_relaxed);
+        cons.head_cache = 0;
+    }
+
+    size_t capacity() const { return cap; }
+    size_t stride() const { return item; }
+
+    // 绝对索引 index 对应的项
+    T *slot(size_t index) const { return data + (index & mask) * item; }
+
+    // ---- 生产者 ----
+
+    // 空闲槽位数。缓存的 tail 显示不足 wanted 时才重新读取消费者的 tail
+    size_t write_available(size_t wanted = 1) {
+        size_t head = prod.head.load(std::memory_order_relaxed);
+        size_t free = cap - (head - prod.tail_cache);
+        if (free < wanted) {
+            prod.tail_cache = cons.tail.load(std::memory_order_acquire);
+            free = cap - (head - prod.tail_cache);
+        }
+        return free;
+    }
+
+    // 下一个空闲槽位的绝对索引
+    size_t write_index() const { return prod.head.load(std::memory_order_relaxed); }
+
+    // 第 k 个空闲槽位（k < write_available()），写完后 commit_write
+    T *write_slot(size_t k = 0) const { return slot(prod.head.load(std::memory_order_relaxed) + k); }
+
+    // 发布 n 个已写入的槽位
+    void commit_write(size_t n) {
+        prod.head.store(prod.head.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+
+    // 当前队列长度（含消费者 peek 着但尚未 commit_read 的项）。总是重新读取消费者的 tail，
+    // 并顺带刷新缓存；write_available 的结果可能基于过时的 tail，不能用来计算占用
+    size_t size() {
+        prod.tail_cache = cons.tail.load(std::memory_order_acquire);
+        return prod.head.load(std::memory_order_relaxed) - prod.tail_cache;
+    }
+
+    // 复制一项（stride 个 T）入队，满时返回 false
+    bool push(const T *src) {
+        if (write_available(1) == 0) return false;
+        memcpy(write_slot(0), src, item * sizeof(T));
+        commit_write(1);
+        return true;
+    }
+
+    // ---- 消费者 ----
+
+    // 可读项数。缓存的 head 显示不足 wanted 时才重新读取生产者的 head
+    size_t read_available(size_t wanted = 1) {
+        size_t tail = cons.tail.load(std::memory_order_relaxed);
+        size_t avail = cons.head_cache - tail;
+        if (avail < wanted) {
+            cons.head_cache = prod.head.load(std::memory_order_acquire);
+            avail = cons.head_cache - tail;
+        }
+        return avail;
+    }
+
+    // 下一个可读项的绝对索引
+    size_t read_index() const { return cons.tail.load(std::memory_order_relaxed); }
+
+    // 第 k 个可读项的零拷贝视图（k < read_available()），在 commit_read 越过它之前有效
+    T *peek(size_t k = 0) const { return slot(cons.tail.load(std::memory_order_relaxed) + k); }
+
+    // 释放 n 个已读完的项，生产者可以复用它们
+    void commit_read(size_t n) {
+        cons.tail.store(cons.tail.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+
+    // 复制至多 max_items 项到 out（max_items * stride 个 T）并出队，返回项数
+    size_t pop_n(T *out, size_t max_items) {
+        size_t n = read_available(max_items);
+        if (n > max_items) n = max_items;
+        if (n == 0) return 0;
+        size_t first_index = cons.tail.load(std::memory_order_relaxed) & mask;
+        size_t first = cap - first_index;
+        if (first > n) first = n;
+        memcpy(out, data + first_index * item, first * item * sizeof(T));
+        if (n > first) memcpy(out + first * item, data, (n - first) * item * sizeof(T));
+        commit_read(n);
+        return n;
+    }
+
+    // ---- 任意线程 ----
+
+    // 近似的队列长度（统计用）
+    size_t size_approx() const {
+        size_t tail = cons.tail.load(std::memory_order_acquire);
+        size_t head = prod.head.load(std::memory_order_acquire);
+        return head - tail;
+    }
+
+private:
+    // producer line: its own index plus its cached copy of the consumer's
+    struct alignas(cache_line) Producer {
+        std::atomic<size_t> head{0};
+        size_t tail_cache = 0;
+    };
+    // consumer line: the mirror image
+    struct alignas(cache_line) Consumer {
+        std::atomic<size_t> tail{0};
+        size_t head_cache = 0;
+    };
+
+    Producer prod;
+    Consumer cons;
+    // read-only after init; kept off both index lines
+    alignas(cache_line) T *data = nullptr;
+    size_t cap = 0;
+    size_t mask = 0;
+    size_t item = 1;
+    std::vector<T> owned;
+};
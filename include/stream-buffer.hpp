@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include <GLES3/gl32.h>
+
+// 流式缓冲：一个 GL buffer 切分为 region_count 个区域轮转写入。
+// 每个区域被绘制（或纹理上传）读取后插入 fence，再次映射前只在 GPU 仍在读取时才等待，
+// 映射使用 UNSYNCHRONIZED | INVALIDATE_RANGE，驱动无需重新分配存储。
+// target 为 GL_ARRAY_BUFFER（顶点）或 GL_PIXEL_UNPACK_BUFFER（纹理上传的像素来源）。
+struct StreamBuffer {
+    GLuint buffer = 0;
+    GLenum target = GL_ARRAY_BUFFER;
+    size_t region_size = 0;       // 每个区域的字节数
+    size_t region_count = 0;
+    size_t current = 0;           // 当前写入的区域
+    bool mapped = false;
+    std::vector<GLsync> fences;   // 每个区域最近一次绘制的 fence
+    // 统计
+    uint64_t maps = 0;            // 映射次数
+    uint64_t stalls = 0;          // 因 GPU 未读完而阻塞的次数
+    uint64_t stall_ns = 0;        // 阻塞总时长
+    uint64_t reallocs = 0;        // 区域过小导致的重新分配次数
+};
+
+// 分配 region_count 个 region_size 字节的区域，绑定点为 target。成功返回 true。
+bool stream_buffer_init(StreamBuffer *sb, size_t region_size, size_t region_count,
+                        GLenum target = GL_ARRAY_BUFFER);
+
+// 释放 buffer 与所有 fence
+void stream_buffer_destroy(StreamBuffer *sb);
+
+// 映射下一个区域的前 size 字节用于写入，buffer 保持绑定在 target。
+// *offset 返回该区域在 buffer 中的字节偏移（用于 glVertexAttribPointer / glTexSubImage2D）。
+// 若 size 超过区域大小则等待所有区域空闲后扩容。失败返回 nullptr。
+void *stream_buffer_map(StreamBuffer *sb, size_t size, size_t *offset);
+
+// 解除映射（在绘制调用之前）
+void stream_buffer_unmap(StreamBuffer *sb);
+
+// 在读取当前区域的绘制或上传调用之后插入 fence 并前进到下一个区域
+void stream_buffer_fence(StreamBuffer *sb);
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+// 线程调度参数：实时优先级（无权限时回退到 nice）与 CPU 亲和性，作用于调用线程。
+// 实时策略带 SCHED_RESET_ON_FORK，线程创建的子进程（cava）不会继承实时优先级或负 nice。
+struct ThreadSched {
+    int policy = 0;            // SCHED_OTHER / SCHED_FIFO / SCHED_RR
+    int priority = 0;          // 实时优先级（1..99），仅 FIFO/RR 使用
+    int nice = 0;              // 未使用实时策略或设置失败时应用的 nice 值，0 表示不改
+    uint64_t cpu_mask = 0;     // 绑定的 CPU（第 i 位对应 CPU i），0 表示不改
+};
+
+// thread_sched_apply 的返回位
+enum thread_sched_applied {
+    THREAD_SCHED_APPLIED_RT = 1,        // 实时策略生效
+    THREAD_SCHED_APPLIED_NICE = 2,      // nice 生效（实时策略未请求或被拒绝）
+    THREAD_SCHED_APPLIED_AFFINITY = 4,  // 亲和性生效
+};
+
+// 调度统计（/proc/thread-self/schedstat，需要内核 CONFIG_SCHED_INFO）
+struct ThreadSchedStats {
+    uint64_t run_ns = 0;       // 在 CPU 上运行的累计时间
+    uint64_t wait_ns = 0;      // 可运行但在运行队列中等待的累计时间（调度延迟）
+    uint64_t slices = 0;       // 获得 CPU 的次数
+};
+
+// 按 sched 设置调用线程，返回实际生效的 thread_sched_applied 位组合
+int thread_sched_apply(const ThreadSched *sched);
+
+// 读取本进程中线程 tid 的调度统计。内核不提供 schedstat 时返回 false
+bool thread_sched_stats(pid_t tid, ThreadSchedStats *out);
+
+// 调用线程的 tid
+pid_t thread_sched_tid();
+
+// 两次采样之间平均每次获得 CPU 前的等待时间（纳秒），没有新的调度时为 0
+uint64_t thread_sched_wait_per_slice(const ThreadSchedStats *before, const ThreadSchedStats *after);
+
+// mlockall 锁定当前与将来的映射，避免换页造成的卡顿（进程范围）。
+// 优先使用 MCL_ONFAULT，只锁定实际访问过的页，驱动的大块映射不会被整体预取。
+bool thread_sched_lock_memory();
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 基于 io_uring 的流式读取，直接使用系统调用（不依赖 liburing）。
+// 读取目标是一块注册缓冲（IORING_REGISTER_BUFFERS），使用 READ_FIXED 免去每次读取的页锁定；
+// 同一个 ring 上还可以挂 POLL_ADD 监视其他 fd（停止信号、pidfd），
+// 一次 io_uring_enter 同时提交下一次读取并等待任意完成。
+// 编译时需定义 CAVA_HAVE_IO_URING（CMake 选项 CAVALAYER_IO_URING），否则 init 总是失败。
+struct UringReader {
+    int ring_fd = -1;
+    // 映射的 SQ/CQ 环与 SQE 数组
+    void *sq_ring = nullptr;
+    size_t sq_ring_size = 0;
+    void *cq_ring = nullptr;              // 内核支持 SINGLE_MMAP 时与 sq_ring 相同
+    size_t cq_ring_size = 0;
+    void *sqes = nullptr;
+    size_t sqes_size = 0;
+    unsigned *sq_head = nullptr;
+    unsigned *sq_tail = nullptr;
+    unsigned *sq_mask = nullptr;
+    unsigned *sq_array = nullptr;
+    unsigned *cq_head = nullptr;
+    unsigned *cq_tail = nullptr;
+    unsigned *cq_mask = nullptr;
+    void *cqes = nullptr;
+    unsigned sq_entries = 0;
+    // 在途请求（读取与 poll）的 tag，取消时逐个发送 ASYNC_CANCEL
+    static const unsigned max_inflight = 8;
+    uint64_t inflight_tags[max_inflight] = {};
+    unsigned inflight = 0;
+    // 注册缓冲
+    uint8_t *buffer = nullptr;
+    size_t buffer_size = 0;
+    // 统计
+    uint64_t enters = 0;                  // io_uring_enter 调用次数
+    uint64_t completions = 0;
+};
+
+// 一个完成事件
+struct UringCompletion {
+    uint64_t tag;                         // 提交时的 tag
+    int32_t res;                          // 读取字节数 / poll 事件掩码，失败时为 -errno
+};
+
+// 创建 entries 深度的 ring。成功返回 true；内核不支持或被禁用时返回 false。
+bool uring_reader_init(UringReader *ur, unsigned entries);
+
+// 取消所有请求、等待其完成并释放 ring（注册缓冲的内存归调用者所有）
+void uring_reader_destroy(UringReader *ur);
+
+// 注册 [base, base + size) 为读取缓冲（替换之前注册的缓冲；调用时不能有读取在途）
+bool uring_reader_register_buffer(UringReader *ur, uint8_t *base, size_t size);
+
+// 排队一次读取到注册缓冲的 [offset, offset + len)。tag 由调用者选择，不能为 UINT64_MAX
+bool uring_reader_queue_read(UringReader *ur, int fd, size_t offset, size_t len, uint64_t tag);
+
+// 排队一次性的 POLLIN 监视
+bool uring_reader_queue_poll(UringReader *ur, int fd, uint64_t tag);
+
+// 提交排队的请求并等待至少一个完成，最多取回 max 个完成。
+// 返回取回的个数，失败返回 -1。
+int uring_reader_wait(UringReader *ur, UringCompletion *out, int max);
+
+// 取消所有在途请求并等待它们完成（之后可以安全释放或替换缓冲）
+void uring_reader_cancel_all(UringReader *ur);
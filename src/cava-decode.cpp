@@ -0,0 +1,309 @@
+#include "cava-decode.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CAVA_DECODE_X86 1
+#include <immintrin.h>
+#elif (defined(__aarch64__) || defined(__ARM_NEON)) && !defined(__ARM_BIG_ENDIAN)
+#define CAVA_DECODE_NEON 1
+#include <arm_neon.h>
+#endif
+
+// scalar reference: assemble little-endian samples byte by byte
+static void decode_u16_scalar(const uint8_t *src, float *dst, size_t count, float scale) {
+    for (size_t i = 0; i < count; ++i) {
+        uint16_t v = (uint16_t)src[i*2] | ((uint16_t)src[i*2 + 1] << 8);
+        dst[i] = (float)v * scale;
+    }
+}
+
+static void decode_u8_scalar(const uint8_t *src, float *dst, size_t count, float scale) {
+    for (size_t i = 0; i < count; ++i) {
+        dst[i] = (float)src[i] * scale;
+    }
+}
+
+// reversed variants: sample i lands in dst[count - 1 - i]
+static void decode_u16_rev_scalar(const uint8_t *src, float *dst, size_t count, float scale) {
+    for (size_t i = 0; i < count; ++i) {
+        uint16_t v = (uint16_t)src[i*2] | ((uint16_t)src[i*2 + 1] << 8);
+        dst[count - 1 - i] = (float)v * scale;
+    }
+}
+
+static void decode_u8_rev_scalar(const uint8_t *src, float *dst, size_t count, float scale) {
+    for (size_t i = 0; i < count; ++i) {
+        dst[count - 1 - i] = (float)src[i] * scale;
+    }
+}
+
+#if defined(CAVA_DECODE_X86)
+// x86 is little-endian, so raw loads match the scalar byte assembly
+
+__attribute__((target("sse2")))
+static void decode_u16_sse2(const uint8_t *src, float *dst, size_t count, float scale) {
+    const __m128 vscale = _mm_set1_ps(scale);
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i*2));
+        __m128 lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero));
+        __m128 hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(v, zero));
+        _mm_storeu_ps(dst + i, _mm_mul_ps(lo, vscale));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(hi, vscale));
+    }
+    decode_u16_scalar(src + i*2, dst + i, count - i, scale);
+}
+
+__attribute__((target("sse2")))
+static void decode_u8_sse2(const uint8_t *src, float *dst, size_t count, float scale) {
+    const __m128 vscale = _mm_set1_ps(scale);
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i w0 = _mm_unpacklo_epi8(v, zero);
+        __m128i w1 = _mm_unpackhi_epi8(v, zero);
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(w0, zero)), vscale));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(w0, zero)), vscale));
+        _mm_storeu_ps(dst + i + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(w1, zero)), vscale));
+        _mm_storeu_ps(dst + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(w1, zero)), vscale));
+    }
+    decode_u8_scalar(src + i, dst + i, count - i, scale);
+}
+
+// reversed kernels: each vector is converted as in the forward kernel, reversed
+// in-register and stored mirrored from the end of dst; the scalar tail fills dst[0..]
+__attribute__((target("sse2")))
+static inline __m128 reverse_ps(__m128 v) {
+    return _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 1, 2, 3));
+}
+
+__attribute__((target("sse2")))
+static void decode_u16_rev_sse2(const uint8_t *src, float *dst, size_t count, float scale) {
+    const __m128 vscale = _mm_set1_ps(scale);
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i*2));
+        __m128 lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero));
+        __m128 hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(v, zero));
+        float *d = dst + count - i - 8;
+        _mm_storeu_ps(d + 4, reverse_ps(_mm_mul_ps(lo, vscale)));
+        _mm_storeu_ps(d, reverse_ps(_mm_mul_ps(hi, vscale)));
+    }
+    decode_u16_rev_scalar(src + i*2, dst, count - i, scale);
+}
+
+__attribute__((target("sse2")))
+static void decode_u8_rev_sse2(const uint8_t *src, float *dst, size_t count, float scale) {
+    const __m128 vscale = _mm_set1_ps(scale);
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i w0 = _mm_unpacklo_epi8(v, zero);
+        __m128i w1 = _mm_unpackhi_epi8(v, zero);
+        float *d = dst + count - i - 16;
+        _mm_storeu_ps(d + 12, reverse_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(w0, zero)), vscale)));
+        _mm_storeu_ps(d + 8, reverse_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(w0, zero)), vscale)));
+        _mm_storeu_ps(d + 4, reverse_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(w1, zero)), vscale)));
+        _mm_storeu_ps(d, reverse_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(w1, zero)), vscale)));
+    }
+    decode_u8_rev_scalar(src + i, dst, count - i, scale);
+}
+
+__attribute__((target("avx2")))
+static void decode_u16_avx2(const uint8_t *src, float *dst, size_t count, float scale) {
+    const __m256 vscale = _mm256_set1_ps(scale);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i a = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(src + i*2)));
+        __m256i b = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(src + i*2 + 16)));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(a), vscale));
+        _mm256_storeu_ps(dst + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(b), vscale));
+    }
+    decode_u16_scalar(src + i*2, dst + i, count - i, scale);
+}
+
+__attribute__((target("avx2")))
+static void decode_u8_avx2(const uint8_t *src, float *dst, size_t count, float scale) {
+    const __m256 vscale = _mm256_set1_ps(scale);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i a = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(src + i)));
+        __m256i b = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(src + i + 8)));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(a), vscale));
+        _mm256_storeu_ps(dst + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(b), vscale));
+    }
+    decode_u8_scalar(src + i, dst + i, count - i, scale);
+}
+
+__attribute__((target("avx2")))
+static void decode_u16_rev_avx2(const uint8_t *src, float *dst, size_t count, float scale) {
+    const __m256 vscale = _mm256_set1_ps(scale);
+    const __m256i reverse = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i a = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(src + i*2)));
+        __m256i b = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(src + i*2 + 16)));
+        float *d = dst + count - i - 16;
+        _mm256_storeu_ps(d + 8, _mm256_permutevar8x32_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(a), vscale), reverse));
+        _mm256_storeu_ps(d, _mm256_permutevar8x32_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(b), vscale), reverse));
+    }
+    decode_u16_rev_scalar(src + i*2, dst, count - i, scale);
+}
+
+__attribute__((target("avx2")))
+static void decode_u8_rev_avx2(const uint8_t *src, float *dst, size_t count, float scale) {
+    const __m256 vscale = _mm256_set1_ps(scale);
+    const __m256i reverse = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i a = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(src + i)));
+        __m256i b = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(src + i + 8)));
+        float *d = dst + count - i - 16;
+        _mm256_storeu_ps(d + 8, _mm256_permutevar8x32_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(a), vscale), reverse));
+        _mm256_storeu_ps(d, _mm256_permutevar8x32_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(b), vscale), reverse));
+    }
+    decode_u8_rev_scalar(src + i, dst, count - i, scale);
+}
+
+__attribute__((target("avx512f")))
+static void decode_u16_avx512(const uint8_t *src, float *dst, size_t count, float scale) {
+    const __m512 vscale = _mm512_set1_ps(scale);
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m512i a = _mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i *)(src + i*2)));
+        __m512i b = _mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i *)(src + i*2 + 32)));
+        _mm512_storeu_ps(dst + i, _mm512_mul_ps(_mm512_cvtepi32_ps(a), vscale));
+        _mm512_storeu_ps(dst + i + 16, _mm512_mul_ps(_mm512_cvtepi32_ps(b), vscale));
+    }
+    decode_u16_scalar(src + i*2, dst + i, count - i, scale);
+}
+
+__attribute__((target("avx512f")))
+static void decode_u8_avx512(const uint8_t *src, float *dst, size_t count, float scale) {
+    const __m512 vscale = _mm512_set1_ps(scale);
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m512i a = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *)(src + i)));
+        __m512i b = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *)(src + i + 16)));
+        _mm512_storeu_ps(dst + i, _mm512_mul_ps(_mm512_cvtepi32_ps(a), vscale));
+        _mm512_storeu_ps(dst + i + 16, _mm512_mul_ps(_mm512_cvtepi32_ps(b), vscale));
+    }
+    decode_u8_scalar(src + i, dst + i, count - i, scale);
+}
+#endif // CAVA_DECODE_X86
+
+#if defined(CAVA_DECODE_NEON)
+static void decode_u16_neon(const uint8_t *src, float *dst, size_t count, float scale) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        uint16x8_t v = vreinterpretq_u16_u8(vld1q_u8(src + i*2));
+        float32x4_t lo = vcvtq_f32_u32(vmovl_u16(vget_low_u16(v)));
+        float32x4_t hi = vcvtq_f32_u32(vmovl_u16(vget_high_u16(v)));
+        vst1q_f32(dst + i, vmulq_n_f32(lo, scale));
+        vst1q_f32(dst + i + 4, vmulq_n_f32(hi, scale));
+    }
+    decode_u16_scalar(src + i*2, dst + i, count - i, scale);
+}
+
+static void decode_u8_neon(const uint8_t *src, float *dst, size_t count, float scale) {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        uint8x16_t v = vld1q_u8(src + i);
+        uint16x8_t w0 = vmovl_u8(vget_low_u8(v));
+        uint16x8_t w1 = vmovl_u8(vget_high_u8(v));
+        vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(w0))), scale));
+        vst1q_f32(dst + i + 4, vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(w0))), scale));
+        vst1q_f32(dst + i + 8, vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(w1))), scale));
+        vst1q_f32(dst + i + 12, vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(w1))), scale));
+    }
+    decode_u8_scalar(src + i, dst + i, count - i, scale);
+}
+
+static inline float32x4_t reverse_f32(float32x4_t v) {
+    float32x4_t r = vrev64q_f32(v);
+    return vcombine_f32(vget_high_f32(r), vget_low_f32(r));
+}
+
+static void decode_u16_rev_neon(const uint8_t *src, float *dst, size_t count, float scale) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        uint16x8_t v = vreinterpretq_u16_u8(vld1q_u8(src + i*2));
+        float32x4_t lo = vcvtq_f32_u32(vmovl_u16(vget_low_u16(v)));
+        float32x4_t hi = vcvtq_f32_u32(vmovl_u16(vget_high_u16(v)));
+        float *d = dst + count - i - 8;
+        vst1q_f32(d + 4, reverse_f32(vmulq_n_f32(lo, scale)));
+        vst1q_f32(d, reverse_f32(vmulq_n_f32(hi, scale)));
+    }
+    decode_u16_rev_scalar(src + i*2, dst, count - i, scale);
+}
+
+static void decode_u8_rev_neon(const uint8_t *src, float *dst, size_t count, float scale) {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        uint8x16_t v = vld1q_u8(src + i);
+        uint16x8_t w0 = vmovl_u8(vget_low_u8(v));
+        uint16x8_t w1 = vmovl_u8(vget_high_u8(v));
+        float *d = dst + count - i - 16;
+        vst1q_f32(d + 12, reverse_f32(vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(w0))), scale)));
+        vst1q_f32(d + 8, reverse_f32(vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(w0))), scale)));
+        vst1q_f32(d + 4, reverse_f32(vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(w1))), scale)));
+        vst1q_f32(d, reverse_f32(vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(w1))), scale)));
+    }
+    decode_u8_rev_scalar(src + i, dst, count - i, scale);
+}
+#endif // CAVA_DECODE_NEON
+
+static const struct cava_decoder decoders[] = {
+    { CAVA_SIMD_SCALAR, "scalar", decode_u16_scalar, decode_u8_scalar, decode_u16_rev_scalar, decode_u8_rev_scalar },
+#if defined(CAVA_DECODE_X86)
+    { CAVA_SIMD_SSE2, "sse2", decode_u16_sse2, decode_u8_sse2, decode_u16_rev_sse2, decode_u8_rev_sse2 },
+    { CAVA_SIMD_AVX2, "avx2", decode_u16_avx2, decode_u8_avx2, decode_u16_rev_avx2, decode_u8_rev_avx2 },
+    // reversal only needs a cross-lane permute, which AVX2 already has
+    { CAVA_SIMD_AVX512, "avx512", decode_u16_avx512, decode_u8_avx512, decode_u16_rev_avx2, decode_u8_rev_avx2 },
+#endif
+#if defined(CAVA_DECODE_NEON)
+    { CAVA_SIMD_NEON, "neon", decode_u16_neon, decode_u8_neon, decode_u16_rev_neon, decode_u8_rev_neon },
+#endif
+};
+
+static bool level_supported(int level) {
+    switch (level) {
+    case CAVA_SIMD_SCALAR:
+        return true;
+#if defined(CAVA_DECODE_X86)
+    case CAVA_SIMD_SSE2:
+        return __builtin_cpu_supports("sse2");
+    case CAVA_SIMD_AVX2:
+        return __builtin_cpu_supports("avx2");
+    case CAVA_SIMD_AVX512:
+        return __builtin_cpu_supports("avx512f");
+#endif
+#if defined(CAVA_DECODE_NEON)
+    case CAVA_SIMD_NEON:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+const struct cava_decoder *cava_decoder_get(int level) {
+    for (const cava_decoder &d : decoders) {
+        if (d.level == level) return level_supported(level) ? &d : nullptr;
+    }
+    return nullptr;
+}
+
+const struct cava_decoder *cava_decoder_select(void) {
+    static const cava_decoder *selected = [] {
+        const cava_decoder *best = &decoders[0];
+        for (const cava_decoder &d : decoders) {
+            if (level_supported(d.level)) best = &d;
+        }
+        return best;
+    }();
+    return selected;
+}
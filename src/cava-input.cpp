@@ -9,52 +9,90 @@
 #include <sys/wait.h>
 #include <sys/stat.h>
 #include <sys/prctl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#include <linux/futex.h>
+#include <sched.h>
+#include <signal.h>
+#include <poll.h>
+#include <time.h>
 #include <errno.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
+#include <new>
 
 #include "cava-input.hpp"
+#include "cava-decode.hpp"
+#include "cava-reader.hpp"
 
-// Internal state
-static std::thread reader_thread;
-static std::atomic<int> running{0};
-static size_t g_bars_number = CAVA_BARS_NUMBER;
-static size_t g_bytes_per_sample = 2;
-static float g_max_value = 65535.0f;
-
-// ring buffer (SPSC) storing contiguous frames
-static float *ring_buf = nullptr;     // allocated as (ring_capacity * bars)
-static size_t ring_capacity = 0;      // number of frames
-static std::atomic<size_t> head{0};   // producer index (next to write)
-static std::atomic<size_t> tail{0};   // consumer index (next to read)
-static size_t ring_mask = 0;          // if capacity is power of two
-
-// child process pid and pipe fd
-static pid_t child_pid = -1;
-static int cava_stdout_fd = -1;
-static char tmp_config_path[128] = {0};
+static const uint32_t MAILBOX_DIRTY = 4;
+
+// io_uring request tags (CAVA_BACKEND_IO_URING)
+static const uint64_t URING_TAG_READ = 1;
+static const uint64_t URING_TAG_WAKE = 2;
+static const uint64_t URING_TAG_CHILD = 3;
+
+// epoll tags of the threadless service fd
+static const uint32_t SERVICE_TAG_DATA = 1;
+static const uint32_t SERVICE_TAG_CHILD = 2;
+static const uint32_t SERVICE_TAG_TIMER = 3;
 
 static inline bool is_power_of_two(size_t x) { return x && ((x & (x - 1)) == 0); }
 
-// create temp config file (mkstemp) and write config content
-static int create_temp_config(const char *bit_format, size_t bars, char *out_path, size_t out_path_len) {
-    char template_path[] = "/tmp/cava_cfg_XXXXXX";
-    int fd = mkstemp(template_path);
-    if (fd < 0) return -1;
-    // keep path for later removal
-    strncpy(out_path, template_path, out_path_len - 1);
-    out_path[out_path_len - 1] = '\0';
+static inline uint64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static inline size_t align_up(size_t v, size_t a) { return (v + a - 1) & ~(a - 1); }
+
+// Write the cava config into an anonymous in-memory file and return its fd.
+// cava reads it as /proc/self/fd/<fd>, which the child inherits across exec,
+// so nothing touches the filesystem and there is no fsync on the start path.
+// Without memfd_create the config goes to an already-unlinked temp file.
+// The framerate value is written fixed-width (left-aligned, space-padded, as
+// iniparser strips trailing blanks; no leading zeros, which strtol would read
+// as octal) so set_framerate can patch it in place with a single pwrite
+// without resizing the file under a cava that may be reading it.
+static const int CONFIG_RATE_WIDTH = 3;
+
+static unsigned clamp_framerate(unsigned fps) {
+    if (fps < 1) return 1;
+    return fps > CAVA_FRAMERATE_MAX ? CAVA_FRAMERATE_MAX : fps;
+}
+
+static void format_framerate(char (&out)[CONFIG_RATE_WIDTH + 1], unsigned fps) {
+    snprintf(out, sizeof(out), "%-*u", CONFIG_RATE_WIDTH, clamp_framerate(fps));
+}
 
-    // compose config similar to Rust code
+static int create_config_fd(const char *bit_format, size_t bars, size_t channels, const char *raw_target,
+                            unsigned framerate, size_t *rate_offset) {
+    // compose config similar to Rust code; cava's bar count covers all channels
     std::string config = "[general]\n";
-    config += "bars = " + std::to_string(bars) + "\n";
-    config += "framerate = 65\n";
+    config += "bars = " + std::to_string(bars * channels) + "\n";
+    char rate[CONFIG_RATE_WIDTH + 1];
+    format_framerate(rate, framerate);
+    config += "framerate = ";
+    *rate_offset = config.size();
+    config += rate;
+    config += "\n";
     config += "autosens = 1\n";
     config += "[output]\n";
     config += "method = raw\n";
-    config += "raw_target = /dev/stdout\n";
+    // cava defaults to stereo; ask for the layout the ring is sized for
+    config += channels == 2 ? "channels = stereo\n" : "channels = mono\n";
+    config += "raw_target = ";
+    config += raw_target;
+    config += "\n";
     config += "bit_format = ";
     config += bit_format;
     config += "\n";
@@ -62,134 +100,990 @@ static int create_temp_config(const char *bit_format, size_t bars, char *out_pat
     config += "monstercat = 1\n";
     config += "noise_reduction = 77\n";
 
-    ssize_t w = write(fd, config.c_str(), config.size());
-    (void)w;
-    fsync(fd);
-    close(fd);
-    return 0;
+    int fd = memfd_create("cava-config", MFD_CLOEXEC);
+    if (fd < 0) {
+        char template_path[] = "/tmp/cava_cfg_XXXXXX";
+        fd = mkostemp(template_path, O_CLOEXEC);
+        if (fd < 0) return -1;
+        unlink(template_path);
+    }
+    size_t off = 0;
+    while (off < config.size()) {
+        ssize_t w = write(fd, config.data() + off, config.size() - off);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) {
+            close(fd);
+            return -1;
+        }
+        off += (size_t)w;
+    }
+    return fd;
 }
 
-// spawn cava with args: cava -p <config_path>
-// returns child's pid and sets out_fd to read end of stdout pipe
-static pid_t spawn_cava_and_pipe_stdout(const char *config_path, int *out_fd) {
-    int pipefd[2];
-    if (pipe(pipefd) < 0) return -1;
-    pid_t pid = fork();
-    if (pid < 0) {
-        close(pipefd[0]); close(pipefd[1]);
+// patch the framerate value written by create_config_fd
+static int write_config_rate(int fd, size_t rate_offset, unsigned framerate) {
+    char rate[CONFIG_RATE_WIDTH + 1];
+    format_framerate(rate, framerate);
+    for (;;) {
+        ssize_t w = pwrite(fd, rate, CONFIG_RATE_WIDTH, (off_t)rate_offset);
+        if (w == CONFIG_RATE_WIDTH) return 0;
+        if (w < 0 && errno == EINTR) continue;
         return -1;
     }
+}
+
+// resolve `name` against $PATH once, so spawning needs no lookups or allocation
+static int find_executable(const char *name, char *out, size_t out_len) {
+    if (strchr(name, '/')) {
+        if (strlen(name) >= out_len) return -1;
+        strcpy(out, name);
+        return access(out, X_OK) == 0 ? 0 : -1;
+    }
+    const char *path = getenv("PATH");
+    if (!path || !path[0]) path = "/usr/local/bin:/usr/bin:/bin";
+    while (*path) {
+        const char *end = strchr(path, ':');
+        size_t dir_len = end ? (size_t)(end - path) : strlen(path);
+        int n = dir_len ? snprintf(out, out_len, "%.*s/%s", (int)dir_len, path, name)
+                        : snprintf(out, out_len, "%s", name);
+        if (n > 0 && (size_t)n < out_len && access(out, X_OK) == 0) return 0;
+        if (!end) break;
+        path = end + 1;
+    }
+    return -1;
+}
+
+// spawn cava with args: cava -p /proc/self/fd/<config_fd>
+// returns child's pid and sets out_fd to read end of stdout pipe.
+// With out_fd == nullptr the child's stdout goes to /dev/null (FIFO transport).
+// A non-null affinity replaces the CPU mask the child would inherit from the
+// (possibly pinned) calling thread.
+static pid_t spawn_cava_and_pipe_stdout(const char *exe, int config_fd, int *out_fd,
+                                        const cpu_set_t *affinity) {
+    int pipefd[2] = {-1, -1};
+    if (out_fd) {
+        // O_CLOEXEC: a concurrently forked cava for another reader must not inherit
+        // our write end, or this pipe would never report EOF
+        if (pipe2(pipefd, O_CLOEXEC) < 0) return -1;
+    } else {
+        pipefd[1] = open("/dev/null", O_WRONLY | O_CLOEXEC);
+        if (pipefd[1] < 0) return -1;
+    }
+    // everything the child needs is prepared before vfork
+    char config_path[32];
+    snprintf(config_path, sizeof(config_path), "/proc/self/fd/%d", config_fd);
+    const char *argv[] = {"cava", "-p", config_path, nullptr};
+    pid_t parent = getpid();
+    sigset_t all, old, empty;
+    sigfillset(&all);
+    sigemptyset(&empty);
+    // keep our signal handlers from running on the shared stack in the child
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+
+    // vfork: the child borrows our address space until execve instead of
+    // copying the page tables of a GL client, and only makes syscalls before exec
+    pid_t pid = vfork();
     if (pid == 0) {
         // child
         // ensure child dies if parent dies
         prctl(PR_SET_PDEATHSIG, SIGTERM);
-        // move write end to stdout
+        if (getppid() != parent) _exit(127);
+        // move write end to stdout (the pipe fds themselves are close-on-exec)
         dup2(pipefd[1], STDOUT_FILENO);
-        // close read end in child
-        close(pipefd[0]);
-        close(pipefd[1]);
-
-        // exec cava
-        const char *argv[] = {"cava", "-p", config_path, nullptr};
-        execvp(argv[0], (char * const*)argv);
+        // the config stays open for cava; only this child's fd table is changed
+        fcntl(config_fd, F_SETFD, 0);
+        if (affinity) sched_setaffinity(0, sizeof(*affinity), affinity);
+        // the parent may block signals for its own signalfd; blocked masks survive exec
+        sigprocmask(SIG_SETMASK, &empty, nullptr);
+        execve(exe, (char * const*)argv, environ);
         // if exec fails
         _exit(127);
-    } else {
-        // parent: close write end, return read end
-        close(pipefd[1]);
-        *out_fd = pipefd[0];
-        // we will do blocking reads in reader thread
-        return pid;
     }
+    pthread_sigmask(SIG_SETMASK, &old, nullptr);
+    // parent: close write end, return read end
+    close(pipefd[1]);
+    if (pid < 0) {
+        if (pipefd[0] >= 0) close(pipefd[0]);
+        return -1;
+    }
+    if (out_fd) *out_fd = pipefd[0];
+    // we will do blocking reads in reader thread
+    return pid;
+}
+
+// ---------------------------------------------------------------------------
+// shared ring
+
+// map a memfd-backed region for `slots` frames of `samples_per_slot` samples
+// (float or raw, see sample_bytes) and fill in the header
+int CavaReader::create_shared_ring(size_t slots, size_t samples_per_slot) {
+    size_t slots_offset = align_up(sizeof(cava_shm_header), 64);
+    size_t data_offset = align_up(slots_offset + slots * sizeof(cava_shm_slot), 64);
+    size_t size = data_offset + slots * samples_per_slot * sample_bytes;
+
+    int fd = memfd_create("cava-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    void *base = MAP_FAILED;
+    if (fd >= 0 && ftruncate(fd, (off_t)size) == 0) {
+        // the size is fixed for the lifetime of the ring; let other mappers rely on that
+        fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW);
+        base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (base == MAP_FAILED) {
+        // no memfd (old kernel / seccomp): fall back to a private anonymous mapping
+        if (fd >= 0) close(fd);
+        fd = -1;
+        base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) return -1;
+    }
+    // fresh pages are zero-filled, so every slot starts with seq == 0
+    shm_base = (uint8_t *)base;
+    shm_bytes = size;
+    shm_memfd = fd;
+    shm_hdr = (cava_shm_header *)shm_base;
+    shm_slots = (cava_shm_slot *)(shm_base + slots_offset);
+    ring_data = shm_base + data_offset;
+
+    shm_hdr->magic = CAVA_SHM_MAGIC;
+    shm_hdr->version = CAVA_SHM_VERSION;
+    shm_hdr->bars = (uint32_t)samples_per_slot;
+    shm_hdr->channels = (uint32_t)channels;
+    shm_hdr->sample_format = (uint32_t)sample_format;
+    shm_hdr->sample_bytes = (uint32_t)sample_bytes;
+    shm_hdr->slot_count = (uint32_t)slots;
+    shm_hdr->slots_offset = (uint32_t)slots_offset;
+    shm_hdr->data_offset = (uint32_t)data_offset;
+    __atomic_store_n(&shm_hdr->latest_slot, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&shm_hdr->published, 0, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void CavaReader::destroy_shared_ring() {
+    if (shm_base) munmap(shm_base, shm_bytes);
+    if (shm_memfd >= 0) close(shm_memfd);
+    shm_base = nullptr;
+    shm_bytes = 0;
+    shm_memfd = -1;
+    shm_hdr = nullptr;
+    shm_slots = nullptr;
+    ring_data = nullptr;
+}
+
+// seqlock: mark `count` slots starting at `first` (wrapping) as being written
+void CavaReader::slots_begin_write(size_t first, size_t count) {
+    for (size_t k = 0; k < count; ++k) {
+        cava_shm_slot &slot = shm_slots[(first + k) % ring_capacity];
+        __atomic_store_n(&slot.seq, __atomic_load_n(&slot.seq, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+// seqlock: publish `count` slots starting at `first`, stamping them with
+// consecutive frame sequence numbers from first_seq and the arrival time,
+// then advance the header
+void CavaReader::slots_end_write(size_t first, size_t count, uint64_t first_seq, uint64_t arrival_ns) {
+    uint64_t published = __atomic_load_n(&shm_hdr->published, __ATOMIC_RELAXED);
+    size_t idx = first;
+    for (size_t k = 0; k < count; ++k) {
+        idx = (first + k) % ring_capacity;
+        cava_shm_slot &slot = shm_slots[idx];
+        __atomic_store_n(&slot.frame_seq, first_seq + k, __ATOMIC_RELAXED);
+        __atomic_store_n(&slot.arrival_ns, arrival_ns, __ATOMIC_RELAXED);
+        __atomic_store_n(&slot.index, published + k, __ATOMIC_RELAXED);
+        __atomic_store_n(&slot.seq, __atomic_load_n(&slot.seq, __ATOMIC_RELAXED) + 1, __ATOMIC_RELEASE);
+    }
+    if (count) {
+        __atomic_store_n(&shm_hdr->latest_slot, (uint32_t)idx, __ATOMIC_RELAXED);
+        __atomic_store_n(&shm_hdr->published, published + count, __ATOMIC_RELEASE);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// reader thread
+
+void CavaReader::signal_ready() {
+    if (ready_fd < 0) return;
+    uint64_t one = 1;
+    ssize_t w = ::write(ready_fd, &one, sizeof(one));
+    (void)w; // EAGAIN only when the counter would overflow; consumer is already awake
+}
+
+// decode `frames` contiguous raw cava frames into normalized floats (SIMD kernel
+// picked at start). Mono is a single kernel call for the whole batch. cava's
+// stereo frame is [left, high to low | right, low to high]; the left half is
+// decoded with the reversing kernel so both lanes come out low to high, each
+// sample still read and written exactly once.
+void CavaReader::decode_frames(const uint8_t *src, float *dst, size_t frames) const {
+    cava_decode_fn fwd = bytes_per_sample == 2 ? decoder->u16 : decoder->u8;
+    if (channels == 1) {
+        fwd(src, dst, bars * frames, scale);
+        return;
+    }
+    cava_decode_fn rev = bytes_per_sample == 2 ? decoder->u16_rev : decoder->u8_rev;
+    size_t lane_bytes = bars * bytes_per_sample;
+    for (size_t f = 0; f < frames; ++f) {
+        rev(src, dst, bars, scale);
+        fwd(src + lane_bytes, dst + bars, bars, scale);
+        src += 2 * lane_bytes;
+        dst += frame_floats;
+    }
+}
+
+// write `frames` raw cava frames into ring slots starting at dst. In
+// CAVA_SAMPLE_RAW mode the bytes go in exactly as cava wrote them, stereo
+// left lane still reversed; flipping it is left to the consumer's indexing.
+void CavaReader::store_frames(const uint8_t *src, uint8_t *dst, size_t frames) const {
+    if (sample_format == CAVA_SAMPLE_FLOAT) {
+        decode_frames(src, reinterpret_cast<float *>(dst), frames);
+        return;
+    }
+    memcpy(dst, src, frames * slot_bytes);
+}
+
+// per-frame decode cost for stats(); single writer, so plain stores are enough
+void CavaReader::note_decoded(size_t frames, uint64_t elapsed_ns) {
+    if (!frames) return;
+    stat_decode_ns_last.store(elapsed_ns / frames, std::memory_order_relaxed);
+    stat_decode_ns.store(stat_decode_ns.load(std::memory_order_relaxed) + elapsed_ns, std::memory_order_relaxed);
+    stat_decoded.store(stat_decoded.load(std::memory_order_relaxed) + frames, std::memory_order_relaxed);
+}
+
+// `occupancy` is the number of unread slots right after this publish
+void CavaReader::note_published(size_t frames, size_t occupancy, uint64_t now_ns) {
+    stat_published.store(stat_published.load(std::memory_order_relaxed) + frames, std::memory_order_relaxed);
+    if (occupancy > stat_high_water.load(std::memory_order_relaxed)) {
+        stat_high_water.store(occupancy, std::memory_order_relaxed);
+    }
+    last_publish_ns.store(now_ns, std::memory_order_relaxed);
 }
 
-static void reader_thread_func() {
-    // block signals in this thread if desired (keep default)
-    size_t chunk_size = g_bytes_per_sample * g_bars_number;
-    std::vector<uint8_t> buffer(chunk_size);
-    ssize_t r;
+// size read_buffer for a full pipe plus one partial frame carried over; with
+// io_uring also register it and arm the stop / child-exit polls for this cava
+bool CavaReader::prepare_read_buffer(size_t chunk_size) {
+    int pipe_bytes = fcntl(cava_data_fd, F_GETPIPE_SZ);
+    size_t capacity = pipe_bytes > 0 ? (size_t)pipe_bytes : 65536;
+    if (capacity < chunk_size) capacity = chunk_size;
+    read_buffer.assign(capacity + chunk_size, 0);
+    if (!use_uring) return true;
+    uring_read_pending = false;
+    uring_child_exited = false;
+    if (!uring_reader_register_buffer(&uring, read_buffer.data(), read_buffer.size())) return false;
+    if (!uring_reader_queue_poll(&uring, wake_fd, URING_TAG_WAKE)) return false;
+    if (child_pidfd >= 0 && !uring_reader_queue_poll(&uring, child_pidfd, URING_TAG_CHILD)) return false;
+    return true;
+}
 
-    while (running.load(std::memory_order_acquire)) {
-        // read exactly chunk_size bytes (blocking). handle short reads.
-        size_t got = 0;
-        while (got < chunk_size) {
-            r = ::read(cava_stdout_fd, buffer.data() + got, chunk_size - got);
+void CavaReader::close_keepalive() {
+    if (fifo_keepalive_fd >= 0) {
+        close(fifo_keepalive_fd);
+        fifo_keepalive_fd = -1;
+    }
+}
+
+// bookkeeping for the first bytes from a (re)spawned cava
+void CavaReader::note_data_arrived() {
+    // With a pidfd our write end stays until reap_child: cava closes and reopens
+    // raw_target on every SIGUSR1 reload, and without a writer in between the
+    // FIFO would read as EOF and turn a framerate change into a respawn. Without
+    // a pidfd, EOF is the only exit signal, so drop it once cava holds the FIFO.
+    if (child_pidfd < 0) close_keepalive();
+    if (!signal_ready_child.load(std::memory_order_relaxed)) {
+        // cava is past its signal setup now; catch up on a framerate change
+        // made while it was starting
+        std::lock_guard<std::mutex> lock(child_mutex);
+        signal_ready_child.store(true, std::memory_order_relaxed);
+        unsigned rate = config_rate.load(std::memory_order_relaxed);
+        if (signal_pid > 0 && child_rate != rate) {
+            kill(signal_pid, SIGUSR1);
+            child_rate = rate;
+            reload_count.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    if (down_since_ns.load(std::memory_order_relaxed)) {
+        // first data from a respawned cava closes the outage
+        uint64_t since = down_since_ns.exchange(0, std::memory_order_relaxed);
+        downtime_total_ns.fetch_add(monotonic_ns() - since, std::memory_order_relaxed);
+    }
+}
+
+// Block until the pipe has data, then pull everything it holds into
+// buffer[*have..] in as few read() calls as possible. Returns false on EOF,
+// a read error, cava's exit (pidfd) or a stop() request.
+bool CavaReader::read_available(std::vector<uint8_t> &buffer, size_t *have) {
+    if (use_uring) return read_available_uring(buffer, have);
+    for (;;) {
+        struct pollfd pfds[3] = {
+            { cava_data_fd, POLLIN, 0 },
+            { wake_fd, POLLIN, 0 },
+            { child_pidfd, POLLIN, 0 },   // ignored by poll when -1
+        };
+        int pr = poll(pfds, 3, -1);
+        if (pr < 0) {
+            if (errno == EINTR) {
+                stat_eintr.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            return false;
+        }
+        if (pfds[1].revents) return false;
+        // data still queued by a cava that just died is read before its exit is handled
+        if (pfds[0].revents) {
+            ssize_t r = ::read(cava_data_fd, buffer.data() + *have, buffer.size() - *have);
             if (r > 0) {
-                got += (size_t)r;
-            } else if (r == 0) {
-                // EOF: cava exited
-                running.store(0);
-                break;
-            } else {
-                if (errno == EINTR) continue;
-                // non-recoverable read error
-                running.store(0);
+                *have += (size_t)r;
+                note_data_arrived();
                 break;
             }
+            if (r < 0 && errno == EINTR) {
+                stat_eintr.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            // EOF: cava exited, or non-recoverable read error
+            return false;
         }
-        if (!running.load(std::memory_order_acquire)) break;
-        // parse to floats
-        // write into ring buffer non-blocking; if full, drop the new frame (mimic try_send)
-        size_t cur_head = head.load(std::memory_order_relaxed);
-        size_t next_head = (cur_head + 1) & ring_mask;
-        size_t cur_tail = tail.load(std::memory_order_acquire);
-        if (next_head == cur_tail) {
-            // full -> drop frame
-            continue;
+        // child exited without the pipe reporting EOF (a FIFO whose write end we still hold)
+        if (pfds[2].revents) return false;
+    }
+    // a pipe read returns at most what was queued; keep going while more is pending
+    int pending = 0;
+    while (*have < buffer.size() && ioctl(cava_data_fd, FIONREAD, &pending) == 0 && pending > 0) {
+        ssize_t r = ::read(cava_data_fd, buffer.data() + *have, buffer.size() - *have);
+        if (r <= 0) break;
+        *have += (size_t)r;
+    }
+    return true;
+}
+
+// io_uring variant of read_available: a single io_uring_enter submits the next
+// READ_FIXED into the registered buffer and sleeps until it, the stop eventfd
+// or the pidfd completes. A pipe read returns everything queued at that point,
+// so one completion covers every frame cava has written since the last one.
+bool CavaReader::read_available_uring(std::vector<uint8_t> &buffer, size_t *have) {
+    if (uring_child_exited) return false;
+    for (;;) {
+        if (!uring_read_pending) {
+            if (!uring_reader_queue_read(&uring, cava_data_fd, *have, buffer.size() - *have, URING_TAG_READ)) {
+                return false;
+            }
+            uring_read_pending = true;
         }
-        float *slot_ptr = ring_buf + (cur_head * g_bars_number);
-        if (g_bytes_per_sample == 2) {
-            for (size_t i = 0; i < g_bars_number; ++i) {
-                uint8_t lo = buffer[i*2];
-                uint8_t hi = buffer[i*2 + 1];
-                uint16_t v = (uint16_t)lo | ((uint16_t)hi << 8);
-                slot_ptr[i] = (float)v / g_max_value;
+        UringCompletion done[4];
+        int n = uring_reader_wait(&uring, done, 4);
+        if (n < 0) return false;
+        bool got = false;
+        bool stop = false;
+        for (int i = 0; i < n; ++i) {
+            if (done[i].tag == URING_TAG_READ) {
+                uring_read_pending = false;
+                if (done[i].res > 0) {
+                    *have += (size_t)done[i].res;
+                    got = true;
+                } else if (done[i].res == -EINTR) {
+                    stat_eintr.fetch_add(1, std::memory_order_relaxed);
+                } else if (done[i].res != -EAGAIN) {
+                    // EOF: cava exited, or non-recoverable read error
+                    stop = true;
+                }
+            } else if (done[i].tag == URING_TAG_WAKE) {
+                stop = true;
+            } else if (done[i].tag == URING_TAG_CHILD) {
+                // hand over what this completion brought, then stop on the next call
+                uring_child_exited = true;
             }
-        } else {
-            for (size_t i = 0; i < g_bars_number; ++i) {
-                uint8_t b = buffer[i];
-                slot_ptr[i] = (float)b / g_max_value;
+        }
+        if (stop) return false;
+        if (got) {
+            note_data_arrived();
+            return true;
+        }
+        if (uring_child_exited) return false;
+    }
+}
+
+// move the trailing partial frame to the front of the buffer
+static void carry_partial(std::vector<uint8_t> &buffer, size_t *have, size_t consumed) {
+    size_t rest = *have - consumed;
+    if (rest && consumed) memmove(buffer.data(), buffer.data() + consumed, rest);
+    *have = rest;
+}
+
+// split read_buffer[0..read_have) into complete frames, publish them the way
+// the ring mode wants and carry the trailing partial frame over
+void CavaReader::publish_available(uint64_t arrival_ns) {
+    size_t chunk_size = bytes_per_sample * frame_floats;
+    stat_reads.fetch_add(1, std::memory_order_relaxed);
+    size_t frames = read_have / chunk_size;
+    if (read_have % chunk_size) stat_short_reads.fetch_add(1, std::memory_order_relaxed);
+    if (frames == 0) return;
+    stat_received.fetch_add(frames, std::memory_order_relaxed);
+    if (ring_mode == CAVA_RING_LATEST) {
+        publish_latest(frames, arrival_ns);
+    } else if (ring_mode == CAVA_RING_BROADCAST) {
+        publish_broadcast(frames, arrival_ns);
+    } else {
+        publish_queue(frames, arrival_ns);
+    }
+    carry_partial(read_buffer, &read_have, frames * chunk_size);
+}
+
+// reader thread: block for data and publish it until cava goes away or stop()
+void CavaReader::loop_read() {
+    if (!prepare_read_buffer(bytes_per_sample * frame_floats)) return;
+    read_have = 0;
+    while (is_running.load(std::memory_order_acquire)) {
+        if (!read_available(read_buffer, &read_have)) break;
+        publish_available(monotonic_ns());
+    }
+}
+
+// CAVA_RING_QUEUE: push every complete frame in order; frames that do not fit
+// in the ring are dropped (mimic try_send)
+void CavaReader::publish_queue(size_t frames, uint64_t arrival) {
+    size_t chunk_size = bytes_per_sample * frame_floats;
+    const uint8_t *src = read_buffer.data();
+    // the cached consumer index is only refreshed when it shows too little room
+    size_t free_slots = queue.write_available(frames);
+    size_t push = frames < free_slots ? frames : free_slots;
+    if (frames > push) {
+        skipped.fetch_add(frames - push, std::memory_order_relaxed);
+    }
+    // decode straight into the ring, at most two contiguous runs (before/after wrap)
+    size_t cur_head = queue.write_index() & ring_mask;
+    size_t first = ring_capacity - cur_head;
+    if (first > push) first = push;
+    slots_begin_write(cur_head, push);
+    if (first) store_frames(src, queue.write_slot(0), first);
+    if (push > first) store_frames(src + first * chunk_size, queue.write_slot(first), push - first);
+    uint64_t decoded = monotonic_ns();
+    note_decoded(push, decoded - arrival);
+    slots_end_write(cur_head, push, rx_seq, arrival);
+    rx_seq += frames;
+    if (push) {
+        queue.commit_write(push);
+        // free_slots may come from a stale tail; take one fresh load per batch for the stat
+        note_published(push, queue.size(), decoded);
+        signal_ready();
+    }
+}
+
+// CAVA_RING_LATEST: decode only the newest complete frame and swap it into the
+// mailbox. Older frames are counted as skipped.
+void CavaReader::publish_latest(size_t frames, uint64_t arrival) {
+    size_t chunk_size = bytes_per_sample * frame_floats;
+    const uint8_t *newest = read_buffer.data() + (frames - 1) * chunk_size;
+    slots_begin_write(mb_back, 1);
+    store_frames(newest, ring_data + (size_t)mb_back * slot_bytes, 1);
+    uint64_t decoded = monotonic_ns();
+    note_decoded(1, decoded - arrival);
+    slots_end_write(mb_back, 1, rx_seq + frames - 1, arrival);
+    rx_seq += frames;
+    uint32_t prev = mailbox.exchange(mb_back | MAILBOX_DIRTY, std::memory_order_acq_rel);
+    mb_back = prev & 3;
+    // frames that were drained but never decoded, plus an unread mailbox frame
+    uint64_t dropped = frames - 1 + ((prev & MAILBOX_DIRTY) ? 1 : 0);
+    if (dropped) skipped.fetch_add(dropped, std::memory_order_relaxed);
+    // the mailbox holds at most one unread frame, plus the consumer's view
+    note_published(1, 1, decoded);
+    signal_ready();
+}
+
+// CAVA_RING_BROADCAST: publish every complete frame in order, overwriting the
+// oldest slots. Consumers are never consulted; a cursor that falls more than
+// ring_capacity frames behind notices via slot.index and skips ahead.
+void CavaReader::publish_broadcast(size_t frames, uint64_t arrival) {
+    size_t chunk_size = bytes_per_sample * frame_floats;
+    // a batch larger than the ring would overwrite itself; keep its newest frames
+    size_t push = frames < ring_capacity ? frames : ring_capacity;
+    if (frames > push) skipped.fetch_add(frames - push, std::memory_order_relaxed);
+    const uint8_t *src = read_buffer.data() + (frames - push) * chunk_size;
+    size_t cur_head = (size_t)(__atomic_load_n(&shm_hdr->published, __ATOMIC_RELAXED) & ring_mask);
+    size_t first = ring_capacity - cur_head;
+    if (first > push) first = push;
+    slots_begin_write(cur_head, push);
+    store_frames(src, ring_data + cur_head * slot_bytes, first);
+    if (push > first) store_frames(src + first * chunk_size, ring_data, push - first);
+    uint64_t decoded = monotonic_ns();
+    note_decoded(push, decoded - arrival);
+    slots_end_write(cur_head, push, rx_seq + frames - push, arrival);
+    rx_seq += frames;
+    // occupancy is per cursor here, so there is no ring-wide high water
+    note_published(push, 0, decoded);
+    notify_cursors();
+    signal_ready();
+}
+
+static long futex(uint32_t *word, int op, uint32_t val, const struct timespec *timeout) {
+    // not FUTEX_PRIVATE: the word lives in the shared ring, other processes may wait on it
+    return syscall(SYS_futex, word, op, val, timeout, nullptr, 0);
+}
+
+// wake cursors blocked in cursor_wait (and other processes waiting on the
+// shm header); a single load when nobody is waiting
+void CavaReader::notify_cursors() {
+    if (!shm_hdr) return;
+    __atomic_fetch_add(&shm_hdr->notify, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&shm_hdr->waiters, __ATOMIC_SEQ_CST)) {
+        futex(&shm_hdr->notify, FUTEX_WAKE, INT_MAX, nullptr);
+    }
+}
+
+// sleep for delay_ns unless stop() wakes us first; returns false when stopping
+bool CavaReader::wait_backoff(uint64_t delay_ns) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)(delay_ns / 1000000000ull);
+    ts.tv_nsec = (long)(delay_ns % 1000000000ull);
+    struct pollfd pfd = { wake_fd, POLLIN, 0 };
+    for (;;) {
+        int pr = ppoll(&pfd, 1, &ts, nullptr);
+        if (pr < 0 && errno == EINTR) continue;
+        return pr == 0 && is_running.load(std::memory_order_acquire);
+    }
+}
+
+// start (or continue) an outage; it ends with the next cava's first data
+void CavaReader::note_cava_down(uint64_t delay_ns) {
+    uint64_t expected = 0;
+    down_since_ns.compare_exchange_strong(expected, monotonic_ns(), std::memory_order_relaxed);
+    fprintf(stderr, "cava_reader: cava exited, restarting in %" PRIu64 " ms\n", delay_ns / 1000000);
+}
+
+// Supervisor: run the read loop until cava goes away, then reap it and spawn a
+// new one with exponential backoff. The ring, the eventfd and the consumer side
+// are untouched across restarts. The thread owns the child and its data fd
+// while it runs; stop() only signals wake_fd and joins.
+void CavaReader::thread_main() {
+    thread_tid.store(thread_sched_tid(), std::memory_order_relaxed);
+    if (sched.policy != SCHED_OTHER || sched.nice != 0 || sched.cpu_mask) {
+        int applied = thread_sched_apply(&sched);
+        bool want_rt = sched.policy == SCHED_FIFO || sched.policy == SCHED_RR;
+        if (want_rt && !(applied & THREAD_SCHED_APPLIED_RT)) {
+            fprintf(stderr, "cava_reader: real-time priority denied, %s\n",
+                    (applied & THREAD_SCHED_APPLIED_NICE) ? "using nice instead" : "keeping default priority");
+        } else if (!want_rt && sched.nice != 0 && !(applied & THREAD_SCHED_APPLIED_NICE)) {
+            fprintf(stderr, "cava_reader: nice %d denied\n", sched.nice);
+        }
+        if (sched.cpu_mask && !(applied & THREAD_SCHED_APPLIED_AFFINITY)) {
+            fprintf(stderr, "cava_reader: CPU affinity 0x%" PRIx64 " rejected\n", sched.cpu_mask);
+        }
+    }
+    if (backend == CAVA_BACKEND_IO_URING) {
+        use_uring = uring_reader_init(&uring, 8);
+        if (!use_uring) {
+            fprintf(stderr, "cava_reader: io_uring unavailable, using read()\n");
+        }
+    }
+    uint64_t delay = restart_delay_ns;
+    while (is_running.load(std::memory_order_acquire)) {
+        uint64_t before = rx_seq;
+        loop_read();
+        // no read may still target read_buffer once this cava is gone
+        if (use_uring) uring_reader_cancel_all(&uring);
+        reap_child();
+        if (!is_running.load(std::memory_order_acquire) || !respawn) break;
+
+        // this cava delivered data, so it was healthy: start the backoff over
+        if (rx_seq != before) delay = restart_delay_ns;
+        note_cava_down(delay);
+        bool spawned = false;
+        while (!spawned) {
+            if (!wait_backoff(delay)) break;
+            delay = delay * 2 < restart_delay_max_ns ? delay * 2 : restart_delay_max_ns;
+            spawned = spawn_child() == 0;
+            if (!spawned) {
+                fprintf(stderr, "cava_reader: respawn failed, retrying in %" PRIu64 " ms\n", delay / 1000000);
             }
         }
-        // publish by moving head
-        head.store(next_head, std::memory_order_release);
-    } // loop
+        if (!spawned) break;
+        restart_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (use_uring) {
+        uring_reader_destroy(&uring);
+        use_uring = false;
+    }
+    is_running.store(0);
+    // wake consumers so they can observe running == 0
+    signal_ready();
+    notify_cursors();
+}
+
+// ---------------------------------------------------------------------------
+// threadless mode
+
+static void arm_oneshot_timer(int timer_fd, uint64_t delay_ns) {
+    struct itimerspec its = {};
+    its.it_value.tv_sec = (time_t)(delay_ns / 1000000000ull);
+    its.it_value.tv_nsec = (long)(delay_ns % 1000000000ull);
+    timerfd_settime(timer_fd, 0, &its, nullptr);
+}
+
+// make the fresh cava's data fd non-blocking and add it (and its pidfd) to the service epoll
+bool CavaReader::service_watch_child() {
+    int flags = fcntl(cava_data_fd, F_GETFL);
+    if (flags < 0 || fcntl(cava_data_fd, F_SETFL, flags | O_NONBLOCK) < 0) return false;
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.u32 = SERVICE_TAG_DATA;
+    if (epoll_ctl(service_fd, EPOLL_CTL_ADD, cava_data_fd, &ev) != 0) return false;
+    if (child_pidfd >= 0) {
+        ev.data.u32 = SERVICE_TAG_CHILD;
+        if (epoll_ctl(service_fd, EPOLL_CTL_ADD, child_pidfd, &ev) != 0) return false;
+    }
+    service_rx_at_spawn = rx_seq;
+    read_have = 0;
+    return prepare_read_buffer(bytes_per_sample * frame_floats);
+}
 
-    // cleanup: close pipe and reap child
-    if (cava_stdout_fd >= 0) {
-        close(cava_stdout_fd);
-        cava_stdout_fd = -1;
+// pull whatever the non-blocking data fd holds and publish it. Returns false
+// on EOF or a read error, i.e. when this cava is gone.
+bool CavaReader::service_read() {
+    for (;;) {
+        size_t space = read_buffer.size() - read_have;
+        ssize_t r = ::read(cava_data_fd, read_buffer.data() + read_have, space);
+        if (r < 0) {
+            if (errno == EINTR) {
+                stat_eintr.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            return errno == EAGAIN;
+        }
+        if (r == 0) return false;
+        read_have += (size_t)r;
+        note_data_arrived();
+        publish_available(monotonic_ns());
+        // a pipe read returns everything queued, so a short read means it is drained
+        if ((size_t)r < space) return true;
+    }
+}
+
+// the supervisor's exit path: reap cava, then either stop or arm the backoff timer
+void CavaReader::service_child_exited() {
+    bool delivered = rx_seq != service_rx_at_spawn;
+    reap_child();
+    if (!respawn) {
+        is_running.store(0);
+        notify_cursors();
+        return;
+    }
+    // this cava delivered data, so it was healthy: start the backoff over
+    if (delivered) service_delay_ns = restart_delay_ns;
+    note_cava_down(service_delay_ns);
+    arm_oneshot_timer(respawn_timer_fd, service_delay_ns);
+}
+
+// backoff expired: spawn the next cava, or re-arm with a doubled delay
+void CavaReader::service_respawn() {
+    uint64_t expirations = 0;
+    ssize_t r = ::read(respawn_timer_fd, &expirations, sizeof(expirations));
+    (void)r;
+    if (child_pid > 0) return;
+    uint64_t delay = service_delay_ns;
+    service_delay_ns = delay * 2 < restart_delay_max_ns ? delay * 2 : restart_delay_max_ns;
+    if (spawn_child() == 0 && service_watch_child()) {
+        restart_count.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    reap_child();
+    fprintf(stderr, "cava_reader: respawn failed, retrying in %" PRIu64 " ms\n", service_delay_ns / 1000000);
+    arm_oneshot_timer(respawn_timer_fd, service_delay_ns);
+}
+
+// One non-blocking pass of the reader thread's work on the caller's thread:
+// a zero-timeout epoll_wait says which of data / child exit / respawn timer
+// is ready, then everything the pipe holds is published.
+int CavaReader::service() {
+    if (!threadless || service_fd < 0) return -1;
+    if (!is_running.load(std::memory_order_relaxed)) return -1;
+    struct epoll_event events[3];
+    int n = epoll_wait(service_fd, events, 3, 0);
+    if (n < 0) {
+        if (errno != EINTR) return -1;
+        stat_eintr.fetch_add(1, std::memory_order_relaxed);
+        n = 0;
+    }
+    bool readable = false;
+    bool exited = false;
+    bool timer = false;
+    for (int i = 0; i < n; ++i) {
+        if (events[i].data.u32 == SERVICE_TAG_DATA) readable = true;
+        if (events[i].data.u32 == SERVICE_TAG_CHILD) exited = true;
+        if (events[i].data.u32 == SERVICE_TAG_TIMER) timer = true;
+    }
+    uint64_t before = stat_published.load(std::memory_order_relaxed);
+    // data still queued by a cava that just died is read before its exit is handled
+    if (readable && !service_read()) exited = true;
+    if (exited && child_pid > 0) service_child_exited();
+    if (timer) service_respawn();
+    int published = (int)(stat_published.load(std::memory_order_relaxed) - before);
+    if (!published && !is_running.load(std::memory_order_relaxed)) return -1;
+    return published;
+}
+
+// ---------------------------------------------------------------------------
+// lifecycle
+
+// create (if needed) the FIFO cava will use as raw_target
+int CavaReader::open_fifo(const char *path) {
+    if (strlen(path) >= sizeof(fifo_path)) return -1;
+    if (mkfifo(path, 0600) == 0) {
+        fifo_created = true;
+    } else {
+        struct stat st;
+        if (errno != EEXIST || stat(path, &st) != 0 || !S_ISFIFO(st.st_mode)) return -1;
+    }
+    strcpy(fifo_path, path);
+    return 0;
+}
+
+// open the data fd (FIFO read end, or a fresh stdout pipe) and spawn cava on it
+int CavaReader::spawn_child() {
+    if (fifo_path[0]) {
+        // non-blocking open of the read end succeeds without a writer; with our own
+        // write end held, reads wait for cava instead of returning EOF
+        cava_data_fd = open(fifo_path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (cava_data_fd < 0) return -1;
+        fifo_keepalive_fd = open(fifo_path, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+        if (fifo_keepalive_fd < 0) {
+            reap_child();
+            return -1;
+        }
+        int flags = fcntl(cava_data_fd, F_GETFL);
+        fcntl(cava_data_fd, F_SETFL, flags & ~O_NONBLOCK);
+    }
+
+    // spawn cava
+    int out_fd = -1;
+    pid_t pid = spawn_cava_and_pipe_stdout(cava_exe, config_fd, fifo_path[0] ? nullptr : &out_fd,
+                                           child_affinity_set ? &child_affinity : nullptr);
+    if (pid <= 0) {
+        reap_child();
+        return -1;
+    }
+    child_pid = pid;
+    {
+        std::lock_guard<std::mutex> lock(child_mutex);
+        signal_pid = pid;
+        // it reads the config as it starts, but must not be sent SIGUSR1 until it has written
+        child_rate = config_rate.load(std::memory_order_relaxed);
+        signal_ready_child.store(false, std::memory_order_relaxed);
+        // a cava respawned while paused starts out stopped as well
+        if (paused_since_ns.load(std::memory_order_relaxed)) kill(pid, SIGSTOP);
+    }
+    if (!fifo_path[0]) cava_data_fd = out_fd;
+    // pidfd reports cava's exit even if something else keeps the pipe open;
+    // without it (kernel < 5.3) EOF on the data fd is the only signal
+#ifdef SYS_pidfd_open
+    child_pidfd = (int)syscall(SYS_pidfd_open, pid, 0);
+#endif
+    if (pipe_size > 0) {
+        // shrink the pipe so cava cannot queue up seconds of stale frames; the kernel
+        // rounds up to a page and refuses sizes below what is already buffered
+        if (fcntl(cava_data_fd, F_SETPIPE_SZ, (int)pipe_size) < 0) {
+            fprintf(stderr, "cava_reader: F_SETPIPE_SZ(%zu) failed: %s\n", pipe_size, strerror(errno));
+        }
+    }
+    return 0;
+}
+
+// stop cava if it is still alive, wait for it, and close its fds
+void CavaReader::reap_child() {
+    close_keepalive();
+    if (service_fd >= 0) {
+        if (cava_data_fd >= 0) epoll_ctl(service_fd, EPOLL_CTL_DEL, cava_data_fd, nullptr);
+        if (child_pidfd >= 0) epoll_ctl(service_fd, EPOLL_CTL_DEL, child_pidfd, nullptr);
+    }
+    if (cava_data_fd >= 0) {
+        close(cava_data_fd);
+        cava_data_fd = -1;
     }
     if (child_pid > 0) {
-        // try to waitpid non-blocking to avoid zombie
+        {
+            // from here on pause()/resume()/set_framerate() leave this pid alone
+            std::lock_guard<std::mutex> lock(child_mutex);
+            signal_pid = -1;
+            signal_ready_child.store(false, std::memory_order_relaxed);
+        }
+        // harmless if it already exited: it stays a zombie until waitpid below.
+        // A stopped cava only acts on SIGTERM once continued.
+        kill(child_pid, SIGTERM);
+        kill(child_pid, SIGCONT);
         int status = 0;
-        waitpid(child_pid, &status, WNOHANG);
+        while (waitpid(child_pid, &status, 0) < 0 && errno == EINTR) {
+        }
         child_pid = -1;
     }
+    if (child_pidfd >= 0) {
+        close(child_pidfd);
+        child_pidfd = -1;
+    }
 }
 
-// PUBLIC API
-int cava_reader_start(const char *bit_format, size_t bars_number, size_t ring_capacity_in) {
-    if (running.load(std::memory_order_acquire)) {
-        return CAVA_ERR; // already running
+// free everything start() set up (fds, config, FIFO, eventfd, ring)
+void CavaReader::release_resources() {
+    reap_child();
+    if (config_fd >= 0) {
+        close(config_fd);
+        config_fd = -1;
+    }
+    if (fifo_path[0] != '\0') {
+        if (fifo_created) unlink(fifo_path);
+        fifo_path[0] = '\0';
+        fifo_created = false;
+    }
+    if (ready_fd >= 0) {
+        close(ready_fd);
+        ready_fd = -1;
+    }
+    if (wake_fd >= 0) {
+        close(wake_fd);
+        wake_fd = -1;
+    }
+    if (service_fd >= 0) {
+        close(service_fd);
+        service_fd = -1;
+    }
+    if (respawn_timer_fd >= 0) {
+        close(respawn_timer_fd);
+        respawn_timer_fd = -1;
+    }
+    // a pause still in progress ends with the stream
+    uint64_t since = paused_since_ns.exchange(0, std::memory_order_relaxed);
+    if (since) paused_total_ns.fetch_add(monotonic_ns() - since, std::memory_order_relaxed);
+    // free buffer
+    destroy_shared_ring();
+    ring_capacity = 0;
+    ring_mask = 0;
+    queue.reset();
+    view_held = false;
+}
+
+uint64_t CavaReader::downtime_ns() const {
+    uint64_t total = downtime_total_ns.load(std::memory_order_relaxed);
+    uint64_t since = down_since_ns.load(std::memory_order_relaxed);
+    return since ? total + (monotonic_ns() - since) : total;
+}
+
+int CavaReader::pause() {
+    if (!running()) return CAVA_ERR;
+    std::lock_guard<std::mutex> lock(child_mutex);
+    if (paused_since_ns.load(std::memory_order_relaxed)) return CAVA_OK;
+    paused_since_ns.store(monotonic_ns(), std::memory_order_relaxed);
+    if (signal_pid > 0) kill(signal_pid, SIGSTOP);
+    return CAVA_OK;
+}
+
+int CavaReader::resume() {
+    if (!running()) return CAVA_ERR;
+    std::lock_guard<std::mutex> lock(child_mutex);
+    uint64_t since = paused_since_ns.exchange(0, std::memory_order_relaxed);
+    if (!since) return CAVA_OK;
+    paused_total_ns.fetch_add(monotonic_ns() - since, std::memory_order_relaxed);
+    if (signal_pid > 0) kill(signal_pid, SIGCONT);
+    return CAVA_OK;
+}
+
+uint64_t CavaReader::paused_ns() const {
+    uint64_t total = paused_total_ns.load(std::memory_order_relaxed);
+    uint64_t since = paused_since_ns.load(std::memory_order_relaxed);
+    return since ? total + (monotonic_ns() - since) : total;
+}
+
+int CavaReader::set_framerate(unsigned fps) {
+    if (!running()) return CAVA_ERR;
+    fps = clamp_framerate(fps);
+    std::lock_guard<std::mutex> lock(child_mutex);
+    if (fps == config_rate.load(std::memory_order_relaxed)) return CAVA_OK;
+    // the next cava to start, or this one on SIGUSR1, reads the patched value
+    if (write_config_rate(config_fd, config_rate_offset, fps) != 0) return CAVA_ERR;
+    config_rate.store(fps, std::memory_order_relaxed);
+    if (signal_pid > 0 && signal_ready_child.load(std::memory_order_relaxed)) {
+        // a stopped (paused) cava reloads once it is continued
+        kill(signal_pid, SIGUSR1);
+        child_rate = fps;
+        reload_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    return CAVA_OK;
+}
+
+void CavaReader::stats(struct cava_reader_stats *out) const {
+    uint64_t dropped = skipped.load(std::memory_order_relaxed);
+    uint64_t decoded = stat_decoded.load(std::memory_order_relaxed);
+    uint64_t published_at = last_publish_ns.load(std::memory_order_relaxed);
+    out->frames_received = stat_received.load(std::memory_order_relaxed);
+    out->frames_published = stat_published.load(std::memory_order_relaxed);
+    out->frames_consumed = stat_consumed.load(std::memory_order_relaxed);
+    out->frames_dropped = ring_mode != CAVA_RING_LATEST ? dropped : 0;
+    out->frames_superseded = ring_mode == CAVA_RING_LATEST ? dropped : 0;
+    out->reads = stat_reads.load(std::memory_order_relaxed);
+    out->short_reads = stat_short_reads.load(std::memory_order_relaxed);
+    out->eintr_retries = stat_eintr.load(std::memory_order_relaxed);
+    out->decode_ns_last = stat_decode_ns_last.load(std::memory_order_relaxed);
+    out->decode_ns_avg = decoded ? stat_decode_ns.load(std::memory_order_relaxed) / decoded : 0;
+    out->ring_capacity = ring_capacity;
+    out->ring_high_water = stat_high_water.load(std::memory_order_relaxed);
+    out->ns_since_last_frame = published_at ? monotonic_ns() - published_at : UINT64_MAX;
+    out->frame_age_ns = frame_age_ns();
+    out->restarts = restarts();
+    out->downtime_ns = downtime_ns();
+    out->paused_ns = paused_ns();
+    out->framerate = running() ? framerate() : 0;
+    out->reloads = reload_count.load(std::memory_order_relaxed);
+    ThreadSchedStats ss;
+    pid_t tid = thread_tid.load(std::memory_order_relaxed);
+    if (tid && thread_sched_stats(tid, &ss)) {
+        out->sched_wait_ns = ss.wait_ns;
+        out->sched_slices = ss.slices;
+    } else {
+        out->sched_wait_ns = 0;
+        out->sched_slices = 0;
+    }
+}
+
+CavaReader::~CavaReader() {
+    stop();
+}
+
+int CavaReader::start(const cava_reader_options *opts) {
+    if (is_running.load(std::memory_order_acquire) || thread.joinable() || service_fd >= 0) {
+        return CAVA_ERR; // already running (or threadless and not stopped yet)
+    }
+    if (!opts || !opts->bit_format) return CAVA_ERR;
+    if (opts->fifo_path && strlen(opts->fifo_path) >= sizeof(fifo_path)) return CAVA_ERR;
+    if (opts->ring_mode != CAVA_RING_QUEUE && opts->ring_mode != CAVA_RING_LATEST &&
+        opts->ring_mode != CAVA_RING_BROADCAST) {
+        return CAVA_ERR;
+    }
+    if (opts->backend != CAVA_BACKEND_READ && opts->backend != CAVA_BACKEND_IO_URING) return CAVA_ERR;
+    if (opts->sched_policy != SCHED_OTHER && opts->sched_policy != SCHED_FIFO && opts->sched_policy != SCHED_RR) {
+        return CAVA_ERR;
     }
-    if (!bit_format) return CAVA_ERR;
-    g_bars_number = bars_number > 0 ? bars_number : CAVA_BARS_NUMBER;
+    const char *bit_format = opts->bit_format;
+    size_t ring_capacity_in = opts->ring_capacity;
+    ring_mode = opts->ring_mode;
+    bars = opts->bars_number > 0 ? opts->bars_number : CAVA_BARS_NUMBER;
+    if (opts->channels != 1 && opts->channels != 2) return CAVA_ERR;
+    channels = (size_t)opts->channels;
+    frame_floats = bars * channels;
     if (strcmp(bit_format, "16bit") == 0) {
-        g_bytes_per_sample = 2;
-        g_max_value = 65535.0f;
+        bytes_per_sample = 2;
+        scale = 1.0f / 65535.0f;
     } else if (strcmp(bit_format, "8bit") == 0) {
-        g_bytes_per_sample = 1;
-        g_max_value = 255.0f;
+        bytes_per_sample = 1;
+        scale = 1.0f / 255.0f;
     } else {
         return CAVA_ERR;
     }
+    if (opts->sample_format != CAVA_SAMPLE_FLOAT && opts->sample_format != CAVA_SAMPLE_RAW) return CAVA_ERR;
+    sample_format = opts->sample_format;
+    sample_bytes = sample_format == CAVA_SAMPLE_RAW ? bytes_per_sample : sizeof(float);
+    slot_bytes = frame_floats * sample_bytes;
+    decoder = cava_decoder_select();
 
+    // the mailbox always uses exactly three slots
+    if (ring_mode == CAVA_RING_LATEST) ring_capacity_in = 3;
     // ring capacity: must be power of two and >= 2
     if (ring_capacity_in < 2) ring_capacity_in = 2;
     size_t cap = ring_capacity_in;
     // round up to power of two if not
-    if (!is_power_of_two(cap)) {
+    if (ring_mode != CAVA_RING_LATEST && !is_power_of_two(cap)) {
         size_t p = 1;
         while (p < cap) p <<= 1;
         cap = p;
@@ -197,98 +1091,699 @@ int cava_reader_start(const char *bit_format, size_t bars_number, size_t ring_ca
     ring_capacity = cap;
     ring_mask = ring_capacity - 1;
 
-    // allocate ring buffer
-    // free old if existed
-    if (ring_buf) {
-        free(ring_buf);
-        ring_buf = nullptr;
-    }
-    ring_buf = (float*)malloc(sizeof(float) * ring_capacity * g_bars_number);
-    if (!ring_buf) return CAVA_ERR;
-    memset(ring_buf, 0, sizeof(float) * ring_capacity * g_bars_number);
-    head.store(0);
-    tail.store(0);
-
-    // create temp config
-    if (create_temp_config(bit_format, g_bars_number, tmp_config_path, sizeof(tmp_config_path)) != 0) {
-        free(ring_buf);
-        ring_buf = nullptr;
+    // allocate ring buffer in shared memory
+    destroy_shared_ring();
+    if (create_shared_ring(ring_capacity, frame_floats) != 0) return CAVA_ERR;
+    queue.init(ring_capacity, slot_bytes, ring_data);
+    view_held = false;
+    mailbox.store(1);
+    mb_back = 0;
+    mb_front = 2;
+    own_cursor = BroadcastCursor();
+    skipped.store(0);
+    last_frame_age_ns.store(0);
+    rx_seq = 0;
+    stat_received.store(0);
+    stat_published.store(0);
+    stat_consumed.store(0);
+    stat_reads.store(0);
+    stat_short_reads.store(0);
+    stat_eintr.store(0);
+    stat_decode_ns.store(0);
+    stat_decoded.store(0);
+    stat_decode_ns_last.store(0);
+    stat_high_water.store(0);
+    last_publish_ns.store(0);
+
+    restart_count.store(0);
+    downtime_total_ns.store(0);
+    down_since_ns.store(0);
+    paused_total_ns.store(0);
+    paused_since_ns.store(0);
+    config_rate.store(clamp_framerate(opts->framerate ? opts->framerate : CAVA_FRAMERATE));
+    signal_ready_child.store(false);
+    reload_count.store(0);
+    pipe_size = opts->pipe_size;
+    backend = opts->backend;
+    respawn = opts->respawn != 0;
+    restart_delay_ns = (uint64_t)(opts->restart_delay_ms ? opts->restart_delay_ms : 1) * 1000000ull;
+    restart_delay_max_ns = (uint64_t)opts->restart_delay_max_ms * 1000000ull;
+    if (restart_delay_max_ns < restart_delay_ns) restart_delay_max_ns = restart_delay_ns;
+    sched.policy = opts->sched_policy;
+    sched.priority = opts->sched_priority;
+    sched.nice = opts->sched_nice;
+    sched.cpu_mask = opts->cpu_affinity;
+    thread_tid.store(0);
+    child_affinity_set = sched.cpu_mask && sched_getaffinity(0, sizeof(child_affinity), &child_affinity) == 0;
+
+    threadless = opts->threadless != 0;
+    if (threadless) {
+        // the caller's poll replaces both eventfds; the respawn timer lives in the same epoll
+        service_fd = epoll_create1(EPOLL_CLOEXEC);
+        respawn_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.u32 = SERVICE_TAG_TIMER;
+        if (service_fd < 0 || respawn_timer_fd < 0 ||
+            epoll_ctl(service_fd, EPOLL_CTL_ADD, respawn_timer_fd, &ev) != 0) {
+            release_resources();
+            return CAVA_ERR;
+        }
+        service_delay_ns = restart_delay_ns;
+    } else {
+        ready_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (ready_fd < 0 || wake_fd < 0) {
+            release_resources();
+            return CAVA_ERR;
+        }
+    }
+
+    // FIFO transport: cava writes to the FIFO instead of stdout
+    const char *raw_target = "/dev/stdout";
+    if (opts->fifo_path && opts->fifo_path[0]) {
+        if (open_fifo(opts->fifo_path) != 0) {
+            release_resources();
+            return CAVA_ERR;
+        }
+        raw_target = fifo_path;
+    }
+
+    config_fd = create_config_fd(bit_format, bars, channels, raw_target, config_rate.load(),
+                                 &config_rate_offset);
+    if (config_fd < 0 || find_executable("cava", cava_exe, sizeof(cava_exe)) != 0) {
+        release_resources();
         return CAVA_ERR;
     }
 
-    // spawn cava
-    int out_fd = -1;
-    pid_t pid = spawn_cava_and_pipe_stdout(tmp_config_path, &out_fd);
-    if (pid <= 0) {
-        unlink(tmp_config_path);
-        free(ring_buf);
-        ring_buf = nullptr;
+    // the first cava is spawned here so spawn failures fail start() outright
+    if (spawn_child() != 0) {
+        release_resources();
         return CAVA_ERR;
     }
-    child_pid = pid;
-    cava_stdout_fd = out_fd;
 
-    running.store(1);
+    if (threadless) {
+        if (!service_watch_child()) {
+            release_resources();
+            return CAVA_ERR;
+        }
+        is_running.store(1);
+        return CAVA_OK;
+    }
+
+    is_running.store(1);
     // start thread
-    reader_thread = std::thread(reader_thread_func);
+    thread = std::thread(&CavaReader::thread_main, this);
     return CAVA_OK;
 }
 
-void cava_reader_stop(void) {
-    if (!running.load(std::memory_order_acquire)) return;
-    running.store(0);
-    // close read fd to wake thread
-    if (cava_stdout_fd >= 0) {
-        close(cava_stdout_fd);
-        cava_stdout_fd = -1;
-    }
-    // kill child if still alive
-    if (child_pid > 0) {
-        kill(child_pid, SIGTERM);
-        // wait for child
-        int status = 0;
-        waitpid(child_pid, &status, 0);
-        child_pid = -1;
+void CavaReader::stop() {
+    if (threadless) {
+        // no thread to signal: cava and every fd are reaped right here
+        if (service_fd < 0) return;
+        is_running.store(0);
+        notify_cursors();
+        release_resources();
+        return;
     }
-    if (reader_thread.joinable()) reader_thread.join();
-    // cleanup config file
-    if (tmp_config_path[0] != '\0') {
-        unlink(tmp_config_path);
-        tmp_config_path[0] = '\0';
+    // the thread may already have exited on EOF; it still needs joining
+    if (!is_running.load(std::memory_order_acquire) && !thread.joinable()) return;
+    is_running.store(0);
+    // interrupt the thread's poll or backoff wait; it reaps cava itself on the way out
+    if (wake_fd >= 0) {
+        uint64_t one = 1;
+        ssize_t w = ::write(wake_fd, &one, sizeof(one));
+        (void)w;
     }
-    // free buffer
-    if (ring_buf) {
-        free(ring_buf);
-        ring_buf = nullptr;
+    if (thread.joinable()) thread.join();
+    release_resources();
+}
+
+// ---------------------------------------------------------------------------
+// consumer
+
+// fill info for the slot a view was just taken from, and record its age
+void CavaReader::take_view(size_t slot_index, cava_frame_info *info) {
+    const cava_shm_slot &slot = shm_slots[slot_index];
+    uint64_t arrival = __atomic_load_n(&slot.arrival_ns, __ATOMIC_RELAXED);
+    last_frame_age_ns.store(monotonic_ns() - arrival, std::memory_order_relaxed);
+    stat_consumed.store(stat_consumed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (info) {
+        info->seq = __atomic_load_n(&slot.frame_seq, __ATOMIC_RELAXED);
+        info->arrival_ns = arrival;
     }
-    ring_capacity = 0;
-    ring_mask = 0;
-    head.store(0);
-    tail.store(0);
 }
 
-int cava_reader_try_pop(float *out_buf, size_t max_len) {
-    if (!out_buf) return -1;
-    if (!running.load(std::memory_order_acquire) && head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire)) {
-        return 0;
-    }
-    if (max_len < g_bars_number) return -1;
-    size_t cur_tail = tail.load(std::memory_order_relaxed);
-    size_t cur_head = head.load(std::memory_order_acquire);
-    if (cur_tail == cur_head) {
-        return 0; // empty
-    }
-    float *slot_ptr = ring_buf + (cur_tail * g_bars_number);
-    memcpy(out_buf, slot_ptr, sizeof(float) * g_bars_number);
-    // advance tail
-    tail.store((cur_tail + 1) & ring_mask, std::memory_order_release);
+int CavaReader::peek(const float **frame, cava_frame_info *info) {
+    if (!frame || sample_format != CAVA_SAMPLE_FLOAT) return -1;
+    const void *view = nullptr;
+    int r = peek_raw(&view, info);
+    if (r == 1) *frame = static_cast<const float *>(view);
+    return r;
+}
+
+int CavaReader::peek_raw(const void **frame, cava_frame_info *info) {
+    // broadcast slots can be overwritten at any time, so there are no views
+    if (!frame || ring_mode == CAVA_RING_BROADCAST) return -1;
+    if (!ring_data) return 0;
+    if (ring_mode == CAVA_RING_LATEST) {
+        if (!(mailbox.load(std::memory_order_acquire) & MAILBOX_DIRTY)) {
+            return 0;
+        }
+        // handing the old front back to the mailbox releases the previous view
+        uint32_t prev = mailbox.exchange(mb_front, std::memory_order_acq_rel);
+        mb_front = prev & 3;
+        take_view(mb_front, info);
+        *frame = ring_data + (size_t)mb_front * slot_bytes;
+        view_held = true;
+        return 1;
+    }
+    size_t held = view_held ? 1 : 0;
+    if (queue.read_available(held + 1) <= held) {
+        return 0; // nothing newer than the held view; keep it valid
+    }
+    if (view_held) queue.commit_read(1);
+    take_view(queue.read_index() & ring_mask, info);
+    *frame = queue.peek(0);
+    view_held = true;
     return 1;
 }
 
+void CavaReader::release() {
+    if (!view_held) return;
+    view_held = false;
+    if (ring_mode == CAVA_RING_QUEUE && ring_data) queue.commit_read(1);
+}
+
+int CavaReader::try_pop(float *out_buf, size_t max_len, cava_frame_info *info) {
+    if (!out_buf || sample_format != CAVA_SAMPLE_FLOAT) return -1;
+    if (!ring_data) return 0;
+    if (max_len < frame_floats) return -1;
+    if (ring_mode == CAVA_RING_BROADCAST) {
+        cava_frame_info local;
+        if (!info) info = &local;
+        int r = cursor_read(&own_cursor, out_buf, max_len * sizeof(float), info);
+        if (r == 1) {
+            last_frame_age_ns.store(monotonic_ns() - info->arrival_ns, std::memory_order_relaxed);
+            stat_consumed.store(stat_consumed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+        return r;
+    }
+    // drop a held view first so try_pop always returns the next unseen frame
+    release();
+    const float *frame = nullptr;
+    int r = peek(&frame, info);
+    if (r != 1) return r;
+    memcpy(out_buf, frame, sizeof(float) * frame_floats);
+    release();
+    return 1;
+}
+
+int CavaReader::try_pop_n(float *out_buf, size_t max_len, cava_frame_info *infos) {
+    if (!out_buf || sample_format != CAVA_SAMPLE_FLOAT) return -1;
+    if (!ring_data) return 0;
+    size_t max_frames = max_len / frame_floats;
+    if (max_frames == 0) return -1;
+    // the mailbox and broadcast modes never have more than one new frame to hand out here
+    if (ring_mode != CAVA_RING_QUEUE) return try_pop(out_buf, max_len, infos);
+    release();
+    size_t n = queue.read_available(max_frames);
+    if (n > max_frames) n = max_frames;
+    if (n == 0) return 0;
+    // slot metadata first: once popped, the producer may reuse the slots
+    size_t first = queue.read_index();
+    uint64_t arrival = 0;
+    for (size_t k = 0; k < n; ++k) {
+        const cava_shm_slot &slot = shm_slots[(first + k) & ring_mask];
+        arrival = __atomic_load_n(&slot.arrival_ns, __ATOMIC_RELAXED);
+        if (infos) {
+            infos[k].seq = __atomic_load_n(&slot.frame_seq, __ATOMIC_RELAXED);
+            infos[k].arrival_ns = arrival;
+        }
+    }
+    queue.pop_n(reinterpret_cast<uint8_t *>(out_buf), n);
+    last_frame_age_ns.store(monotonic_ns() - arrival, std::memory_order_relaxed);
+    stat_consumed.store(stat_consumed.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    return (int)n;
+}
+
+int CavaReader::wait_pop(float *out_buf, size_t max_len, int64_t timeout_ns) {
+    struct timespec deadline = {0, 0};
+    if (timeout_ns > 0) {
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += timeout_ns / 1000000000LL;
+        deadline.tv_nsec += timeout_ns % 1000000000LL;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec += 1;
+            deadline.tv_nsec -= 1000000000L;
+        }
+    }
+    for (;;) {
+        // a publish between this pop and the poll below leaves the eventfd readable,
+        // so no wake-up can be lost
+        if (threadless) service();
+        int r = try_pop(out_buf, max_len);
+        if (r != 0) return r;
+        if (!is_running.load(std::memory_order_acquire) || fd() < 0) return 0;
+        if (timeout_ns == 0) return 0;
+
+        struct timespec remaining;
+        struct timespec *tsp = nullptr;
+        if (timeout_ns > 0) {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            int64_t left = (int64_t)(deadline.tv_sec - now.tv_sec) * 1000000000LL + (deadline.tv_nsec - now.tv_nsec);
+            if (left <= 0) return 0;
+            remaining.tv_sec = left / 1000000000LL;
+            remaining.tv_nsec = left % 1000000000LL;
+            tsp = &remaining;
+        }
+        struct pollfd pfd = { fd(), POLLIN, 0 };
+        int pr = ppoll(&pfd, 1, tsp, nullptr);
+        if (pr < 0 && errno != EINTR) return -1;
+        if (pr > 0 && !threadless) {
+            uint64_t count;
+            ssize_t rd = ::read(ready_fd, &count, sizeof(count));
+            (void)rd;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// broadcast cursors
+
+// start at the next frame to be published
+void CavaReader::cursor_open(BroadcastCursor *cursor) const {
+    cursor->next = shm_hdr ? __atomic_load_n(&shm_hdr->published, __ATOMIC_ACQUIRE) : 0;
+    cursor->missed = 0;
+}
+
+void CavaReader::cursor_seek_latest(BroadcastCursor *cursor) const {
+    if (!shm_hdr) return;
+    uint64_t published = __atomic_load_n(&shm_hdr->published, __ATOMIC_ACQUIRE);
+    if (published > cursor->next + 1) {
+        cursor->missed += published - 1 - cursor->next;
+        cursor->next = published - 1;
+    }
+}
+
+// Seqlock copy of the cursor's next frame. The copy is kept only if the slot
+// was stable across it and still holds that publish index; otherwise the
+// producer lapped this cursor, the frame is gone and the cursor moves on.
+// Never writes shared memory, so readers cannot slow the producer or each other.
+int CavaReader::cursor_read(BroadcastCursor *cursor, void *out, size_t out_bytes, cava_frame_info *info) const {
+    if (!out || ring_mode != CAVA_RING_BROADCAST) return -1;
+    if (!shm_hdr) return 0;
+    if (out_bytes < slot_bytes) return -1;
+    for (;;) {
+        uint64_t published = __atomic_load_n(&shm_hdr->published, __ATOMIC_ACQUIRE);
+        if (cursor->next >= published) return 0;
+        uint64_t oldest = published > ring_capacity ? published - ring_capacity : 0;
+        if (cursor->next < oldest) {
+            cursor->missed += oldest - cursor->next;
+            cursor->next = oldest;
+        }
+        size_t idx = (size_t)(cursor->next & ring_mask);
+        const cava_shm_slot &slot = shm_slots[idx];
+        uint64_t seq = __atomic_load_n(&slot.seq, __ATOMIC_ACQUIRE);
+        uint64_t index = __atomic_load_n(&slot.index, __ATOMIC_RELAXED);
+        uint64_t frame_seq = __atomic_load_n(&slot.frame_seq, __ATOMIC_RELAXED);
+        uint64_t arrival = __atomic_load_n(&slot.arrival_ns, __ATOMIC_RELAXED);
+        memcpy(out, ring_data + idx * slot_bytes, slot_bytes);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        bool stable = (seq & 1) == 0 && __atomic_load_n(&slot.seq, __ATOMIC_RELAXED) == seq;
+        if (stable && index == cursor->next) {
+            cursor->next++;
+            if (info) {
+                info->seq = frame_seq;
+                info->arrival_ns = arrival;
+            }
+            return 1;
+        }
+        cursor->missed++;
+        cursor->next++;
+    }
+}
+
+// Block until the cursor has a frame to read (1), or the timeout expires or
+// the reader stops (0). Sleeps on the header's futex word; the producer only
+// makes the wake syscall while someone is registered in `waiters`.
+int CavaReader::cursor_wait(const BroadcastCursor *cursor, int64_t timeout_ns) const {
+    if (ring_mode != CAVA_RING_BROADCAST) return -1;
+    if (!shm_hdr) return 0;
+    uint64_t deadline = timeout_ns > 0 ? monotonic_ns() + (uint64_t)timeout_ns : 0;
+    for (;;) {
+        uint32_t word = __atomic_load_n(&shm_hdr->notify, __ATOMIC_ACQUIRE);
+        if (cursor->next < __atomic_load_n(&shm_hdr->published, __ATOMIC_ACQUIRE)) return 1;
+        if (!is_running.load(std::memory_order_acquire) || timeout_ns == 0) return 0;
+        struct timespec ts;
+        struct timespec *tsp = nullptr;
+        if (timeout_ns > 0) {
+            uint64_t now = monotonic_ns();
+            if (now >= deadline) return 0;
+            ts.tv_sec = (time_t)((deadline - now) / 1000000000ull);
+            ts.tv_nsec = (long)((deadline - now) % 1000000000ull);
+            tsp = &ts;
+        }
+        // register before the final check: either the producer sees us in
+        // `waiters`, or we see its publish (both sides are seq_cst)
+        __atomic_fetch_add(&shm_hdr->waiters, 1, __ATOMIC_SEQ_CST);
+        if (cursor->next >= __atomic_load_n(&shm_hdr->published, __ATOMIC_SEQ_CST) &&
+            is_running.load(std::memory_order_seq_cst)) {
+            futex(&shm_hdr->notify, FUTEX_WAIT, word, tsp);
+        }
+        __atomic_fetch_sub(&shm_hdr->waiters, 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// PUBLIC API
+
+void cava_reader_options_init(struct cava_reader_options *opts) {
+    if (!opts) return;
+    opts->bit_format = "16bit";
+    opts->bars_number = CAVA_BARS_NUMBER;
+    opts->channels = 1;
+    opts->ring_capacity = 16;
+    opts->ring_mode = CAVA_RING_QUEUE;
+    opts->pipe_size = 0;
+    opts->fifo_path = nullptr;
+    opts->backend = CAVA_BACKEND_READ;
+    opts->respawn = 1;
+    opts->restart_delay_ms = 100;
+    opts->restart_delay_max_ms = 10000;
+    opts->sched_policy = SCHED_OTHER;
+    opts->sched_priority = 0;
+    opts->sched_nice = 0;
+    opts->cpu_affinity = 0;
+    opts->sample_format = CAVA_SAMPLE_FLOAT;
+    opts->threadless = 0;
+    opts->framerate = CAVA_FRAMERATE;
+}
+
+// the process-wide reader behind the cava_reader_* functions
+static CavaReader default_reader;
+
+int cava_reader_start(const char *bit_format, size_t bars_number, size_t ring_capacity_in) {
+    struct cava_reader_options opts;
+    cava_reader_options_init(&opts);
+    opts.bit_format = bit_format;
+    opts.bars_number = bars_number;
+    opts.ring_capacity = ring_capacity_in;
+    return cava_reader_start_ex(&opts);
+}
+
+int cava_reader_start_ex(const struct cava_reader_options *opts) {
+    return default_reader.start(opts);
+}
+
+void cava_reader_stop(void) {
+    default_reader.stop();
+}
+
+int cava_reader_try_pop(float *out_buf, size_t max_len) {
+    return default_reader.try_pop(out_buf, max_len);
+}
+
+int cava_reader_try_pop_ex(float *out_buf, size_t max_len, struct cava_frame_info *info) {
+    return default_reader.try_pop(out_buf, max_len, info);
+}
+
+int cava_reader_try_pop_n(float *out_buf, size_t max_len, struct cava_frame_info *infos) {
+    return default_reader.try_pop_n(out_buf, max_len, infos);
+}
+
+int cava_reader_peek(const float **frame) {
+    return default_reader.peek(frame);
+}
+
+int cava_reader_peek_ex(const float **frame, struct cava_frame_info *info) {
+    return default_reader.peek(frame, info);
+}
+
+int cava_reader_peek_raw(const void **frame, struct cava_frame_info *info) {
+    return default_reader.peek_raw(frame, info);
+}
+
+void cava_reader_release(void) {
+    default_reader.release();
+}
+
+int cava_reader_wait_pop(float *out_buf, size_t max_len, int64_t timeout_ns) {
+    return default_reader.wait_pop(out_buf, max_len, timeout_ns);
+}
+
+int cava_reader_shm_fd(void) {
+    return default_reader.shm_fd();
+}
+
+size_t cava_reader_shm_size(void) {
+    return default_reader.shm_size();
+}
+
+uint64_t cava_reader_skipped_frames(void) {
+    return default_reader.skipped_frames();
+}
+
+uint64_t cava_reader_frame_age_ns(void) {
+    return default_reader.frame_age_ns();
+}
+
+uint64_t cava_reader_restarts(void) {
+    return default_reader.restarts();
+}
+
+uint64_t cava_reader_downtime_ns(void) {
+    return default_reader.downtime_ns();
+}
+
+int cava_reader_pause(void) {
+    return default_reader.pause();
+}
+
+int cava_reader_resume(void) {
+    return default_reader.resume();
+}
+
+int cava_reader_paused(void) {
+    return default_reader.paused() ? 1 : 0;
+}
+
+uint64_t cava_reader_paused_ns(void) {
+    return default_reader.paused_ns();
+}
+
+int cava_reader_set_framerate(unsigned framerate) {
+    return default_reader.set_framerate(framerate);
+}
+
+unsigned cava_reader_framerate(void) {
+    return default_reader.running() ? default_reader.framerate() : 0;
+}
+
+int cava_reader_stats(struct cava_reader_stats *out) {
+    if (!out) return CAVA_ERR;
+    default_reader.stats(out);
+    return CAVA_OK;
+}
+
 size_t cava_reader_bars_number(void) {
-    return g_bars_number;
+    return default_reader.bars_number();
+}
+
+size_t cava_reader_channels(void) {
+    return default_reader.channel_count();
+}
+
+int cava_reader_sample_format(void) {
+    return default_reader.sample_format_in_use();
+}
+
+size_t cava_reader_sample_bytes(void) {
+    return default_reader.sample_size();
+}
+
+int cava_reader_service(void) {
+    return default_reader.service();
+}
+
+int cava_reader_fd(void) {
+    return default_reader.fd();
 }
 
 int cava_reader_running(void) {
-    return running.load(std::memory_order_acquire) ? 1 : 0;
-}
\ No newline at end of file
+    return default_reader.running() ? 1 : 0;
+}
+
+// handle API: struct cava_stream is an opaque wrapper around one CavaReader
+struct cava_stream {
+    CavaReader reader;
+};
+
+cava_stream *cava_stream_start(const struct cava_reader_options *opts) {
+    cava_stream *stream = new (std::nothrow) cava_stream;
+    if (!stream) return nullptr;
+    if (stream->reader.start(opts) != CAVA_OK) {
+        delete stream;
+        return nullptr;
+    }
+    return stream;
+}
+
+void cava_stream_stop(cava_stream *stream) {
+    delete stream; // ~CavaReader stops and joins
+}
+
+int cava_stream_try_pop(cava_stream *stream, float *out_buf, size_t max_len, struct cava_frame_info *info) {
+    return stream ? stream->reader.try_pop(out_buf, max_len, info) : -1;
+}
+
+int cava_stream_try_pop_n(cava_stream *stream, float *out_buf, size_t max_len, struct cava_frame_info *infos) {
+    return stream ? stream->reader.try_pop_n(out_buf, max_len, infos) : -1;
+}
+
+int cava_stream_wait_pop(cava_stream *stream, float *out_buf, size_t max_len, int64_t timeout_ns) {
+    return stream ? stream->reader.wait_pop(out_buf, max_len, timeout_ns) : -1;
+}
+
+int cava_stream_peek(cava_stream *stream, const float **frame, struct cava_frame_info *info) {
+    return stream ? stream->reader.peek(frame, info) : -1;
+}
+
+int cava_stream_peek_raw(cava_stream *stream, const void **frame, struct cava_frame_info *info) {
+    return stream ? stream->reader.peek_raw(frame, info) : -1;
+}
+
+void cava_stream_release(cava_stream *stream) {
+    if (stream) stream->reader.release();
+}
+
+int cava_stream_service(cava_stream *stream) {
+    return stream ? stream->reader.service() : -1;
+}
+
+int cava_stream_fd(const cava_stream *stream) {
+    return stream ? stream->reader.fd() : -1;
+}
+
+int cava_stream_running(const cava_stream *stream) {
+    return stream && stream->reader.running() ? 1 : 0;
+}
+
+size_t cava_stream_bars_number(const cava_stream *stream) {
+    return stream ? stream->reader.bars_number() : 0;
+}
+
+size_t cava_stream_channels(const cava_stream *stream) {
+    return stream ? stream->reader.channel_count() : 0;
+}
+
+int cava_stream_sample_format(const cava_stream *stream) {
+    return stream ? stream->reader.sample_format_in_use() : CAVA_SAMPLE_FLOAT;
+}
+
+size_t cava_stream_sample_bytes(const cava_stream *stream) {
+    return stream ? stream->reader.sample_size() : 0;
+}
+
+uint64_t cava_stream_skipped_frames(const cava_stream *stream) {
+    return stream ? stream->reader.skipped_frames() : 0;
+}
+
+uint64_t cava_stream_frame_age_ns(const cava_stream *stream) {
+    return stream ? stream->reader.frame_age_ns() : 0;
+}
+
+uint64_t cava_stream_restarts(const cava_stream *stream) {
+    return stream ? stream->reader.restarts() : 0;
+}
+
+uint64_t cava_stream_downtime_ns(const cava_stream *stream) {
+    return stream ? stream->reader.downtime_ns() : 0;
+}
+
+int cava_stream_pause(cava_stream *stream) {
+    return stream ? stream->reader.pause() : CAVA_ERR;
+}
+
+int cava_stream_resume(cava_stream *stream) {
+    return stream ? stream->reader.resume() : CAVA_ERR;
+}
+
+int cava_stream_paused(const cava_stream *stream) {
+    return stream && stream->reader.paused() ? 1 : 0;
+}
+
+uint64_t cava_stream_paused_ns(const cava_stream *stream) {
+    return stream ? stream->reader.paused_ns() : 0;
+}
+
+int cava_stream_set_framerate(cava_stream *stream, unsigned framerate) {
+    return stream ? stream->reader.set_framerate(framerate) : CAVA_ERR;
+}
+
+unsigned cava_stream_framerate(const cava_stream *stream) {
+    return stream && stream->reader.running() ? stream->reader.framerate() : 0;
+}
+
+int cava_stream_stats(const cava_stream *stream, struct cava_reader_stats *out) {
+    if (!stream || !out) return CAVA_ERR;
+    stream->reader.stats(out);
+    return CAVA_OK;
+}
+
+int cava_stream_shm_fd(const cava_stream *stream) {
+    return stream ? stream->reader.shm_fd() : -1;
+}
+
+size_t cava_stream_shm_size(const cava_stream *stream) {
+    return stream ? stream->reader.shm_size() : 0;
+}
+
+// broadcast cursors: struct cava_cursor is one BroadcastCursor bound to its reader
+struct cava_cursor {
+    CavaReader *reader;
+    BroadcastCursor pos;
+};
+
+static cava_cursor *open_cursor(CavaReader *reader) {
+    if (!reader->running() || reader->mode() != CAVA_RING_BROADCAST) return nullptr;
+    cava_cursor *cursor = new (std::nothrow) cava_cursor;
+    if (!cursor) return nullptr;
+    cursor->reader = reader;
+    reader->cursor_open(&cursor->pos);
+    return cursor;
+}
+
+cava_cursor *cava_reader_cursor_open(void) {
+    return open_cursor(&default_reader);
+}
+
+cava_cursor *cava_stream_cursor_open(cava_stream *stream) {
+    return stream ? open_cursor(&stream->reader) : nullptr;
+}
+
+void cava_cursor_close(cava_cursor *cursor) {
+    delete cursor;
+}
+
+int cava_cursor_read(cava_cursor *cursor, float *out_buf, size_t max_len, struct cava_frame_info *info) {
+    if (!cursor || cursor->reader->sample_format_in_use() != CAVA_SAMPLE_FLOAT) return -1;
+    return cursor->reader->cursor_read(&cursor->pos, out_buf, max_len * sizeof(float), info);
+}
+
+int cava_cursor_read_raw(cava_cursor *cursor, void *out, size_t max_bytes, struct cava_frame_info *info) {
+    return cursor ? cursor->reader->cursor_read(&cursor->pos, out, max_bytes, info) : -1;
+}
+
+int cava_cursor_wait(const cava_cursor *cursor, int64_t timeout_ns) {
+    return cursor ? cursor->reader->cursor_wait(&cursor->pos, timeout_ns) : -1;
+}
+
+void cava_cursor_seek_latest(cava_cursor *cursor) {
+    if (cursor) cursor->reader->cursor_seek_latest(&cursor->pos);
+}
+
+uint64_t cava_cursor_missed(const cava_cursor *cursor) {
+    return cursor ? cursor->pos.missed : 0;
+}
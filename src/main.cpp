@@ -1,14 +1,21 @@
+#include <cerrno>
+#include <chrono>
 #include <cstring>
 #include <cmath>
 #include <iostream>
 #include <memory>
 #include <vector>
+#include <poll.h>
+#include <signal.h>
 #include <unistd.h>
+#include <sched.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
 #include <wayland-client.h>
 #include <wayland-egl.h>
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
-#include <GLES2/gl2.h>
+#include <GLES3/gl32.h>
 #include <GLES2/gl2ext.h>
 
 #define namespace ns
@@ -16,6 +23,9 @@
 #undef namespace
 #include "cava-input.hpp"
 #include "shaders.hpp"
+#include "spline.hpp"
+#include "stream-buffer.hpp"
+#include "thread-sched.hpp"
 
 // RAII包装
 struct WlDeleter {
@@ -30,6 +40,82 @@ struct WlDeleter {
     void operator()(wl_seat* s) const { if (s) wl_seat_destroy(s); }
 };
 
+// 渲染模式：CPU 细分三角带后整体上传，或只上传控制点/切线由顶点着色器重建
+enum class RenderMode {
+    CpuSpline,
+    GpuSpline,
+};
+
+// 立体声布局：左右声道镜像（低频在中间，左声道在左半屏），或两条曲线叠加铺满全宽
+enum class ChannelLayout {
+    Mirrored,
+    Overlay,
+};
+
+// 提交一帧后等待帧回调的期限，超时视为 compositor 未在显示该 surface
+static const long frame_deadline_ms = 250;
+// 同一个帧回调连续错过这么多个期限（2 秒）才视为不可见并暂停 cava。部分 compositor 把被遮挡或
+// 未聚焦的 surface 的帧回调节流到约 1 Hz，只错过一个期限就暂停会每秒 SIGSTOP/SIGCONT 一次
+static const int hidden_after_missed_deadlines = 8;
+// 连续静音（整帧为 0）超过该时长后暂停 cava
+static const long silence_pause_ms = 3000;
+// 静音暂停期间每隔 silence_probe_interval_ms 恢复 cava silence_probe_window_ms，探测声音是否回来；
+// cava 只有约 1/9 的时间在运行，声音恢复后最迟 silence_probe_interval_ms 重新出帧
+static const long silence_probe_interval_ms = 2000;
+static const long silence_probe_window_ms = 250;
+// cava 帧率自适应：电平（帧峰值的指数平均）高于 loud_level 时跟随 surface 所在输出的刷新率
+// （未知时 CAVA_FRAMERATE），低于 quiet_level 或 surface 窄于 small_surface_width 时降到 quiet_framerate，
+// 之间保持不变。改变帧率会让 cava 重新打开音频输入，两次改变至少间隔 framerate_hold_ms
+static const unsigned quiet_framerate = 30;
+static const float loud_level = 0.5f;
+static const float quiet_level = 0.15f;
+static const float level_smoothing = 0.05f;
+static const long framerate_hold_ms = 2000;
+static const int small_surface_width = 240;
+// 流式顶点缓冲的区域数（CPU 模式）
+static const size_t vertex_stream_regions = 3;
+// 原始样本像素解包缓冲的区域数（GPU 模式）
+static const size_t upload_stream_regions = 3;
+
+// 冷启动各阶段完成的时刻（相对 main() 入口；ClientState 在 main() 入口构造），
+// 第一帧频谱被 compositor 呈现后输出一次
+struct StartupTimes {
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::duration reader_started{};   // cava_reader_start_ex 返回
+    std::chrono::steady_clock::duration configured{};       // 收到首个 configure
+    std::chrono::steady_clock::duration gl_ready{};         // surface、着色器全部就绪
+    std::chrono::steady_clock::duration first_decoded{};    // 读取线程解码出第一帧
+    std::chrono::steady_clock::duration first_swap{};       // 第一帧频谱 eglSwapBuffers
+    bool swapped = false;
+    bool reported = false;
+
+    std::chrono::steady_clock::duration since_begin() const {
+        return std::chrono::steady_clock::now() - begin;
+    }
+};
+
+// 已绑定的 wl_output 及其当前模式的刷新率
+struct OutputInfo {
+    wl_output *output = nullptr;
+    uint32_t name = 0;          // registry 中的全局名
+    int32_t refresh_mhz = 0;    // 0 表示未知
+};
+
+// 每帧 CPU 准备与上传开销统计，周期性输出用于对比渲染模式
+struct FrameStats {
+    std::chrono::steady_clock::time_point window_start = std::chrono::steady_clock::now();
+    uint64_t frames = 0;
+    uint64_t prepare_ns = 0;
+    uint64_t upload_bytes = 0;
+    uint64_t wakeups = 0;       // 主循环醒来次数
+    uint64_t missed_deadlines = 0; // 超过 frame_deadline_ms 才到达（或一直未到达）的帧回调数
+    // 频谱帧到达间隔（cava_frame_info::arrival_ns 之差），用于计算抖动
+    uint64_t intervals = 0;
+    double interval_sum_ms = 0.0;
+    double interval_sq_sum_ms = 0.0;
+    uint64_t seq_gaps = 0;         // 帧序号不连续而未被取到的帧数
+};
+
 struct ClientState {
     // Wayland 资源
     std::unique_ptr<wl_display, WlDeleter> display;
@@ -42,24 +128,93 @@ struct ClientState {
     std::unique_ptr<wl_egl_window, WlDeleter> egl_window;
     std::unique_ptr<wl_seat, WlDeleter> seat;
     wl_keyboard *keyboard = nullptr;
+    std::vector<OutputInfo> outputs;
+    wl_output *surface_output = nullptr;   // surface 最近进入的输出
     // EGL 资源
     EGLDisplay egl_display = EGL_NO_DISPLAY;
     EGLContext egl_context = EGL_NO_CONTEXT;
     EGLSurface egl_surface = EGL_NO_SURFACE;
+    EGLConfig egl_config = nullptr;
+    bool shaders_started = false;          // 着色器已提交编译（可能仍在驱动线程中进行）
+    bool parallel_shader_compile = false;  // GL_KHR_parallel_shader_compile 可用
     GLuint program = 0;
-    GLuint vbo = 0;
+    StreamBuffer vertex_stream;
+    StreamBuffer upload_stream;            // 原始样本经 GL_PIXEL_UNPACK_BUFFER 上传（GPU 模式）
     GLuint position_attr = -1;
     GLuint colorTop_uniform = -1;
     GLuint colorBottom_uniform = -1;
+    GLuint spline_program = 0;
+    GLuint spline_texture = 0;
+    size_t spline_texture_width = 0;
+    size_t spline_texture_height = 0;      // 每个声道一行
+    GLint spline_colorTop_uniform = -1;
+    GLint spline_colorBottom_uniform = -1;
+    GLint spline_screenHeight_uniform = -1;
+    GLint spline_pointCount_uniform = -1;
+    GLint spline_pointsPerSegment_uniform = -1;
+    GLint spline_controlPoints_uniform = -1;
+    GLint spline_mirrored_uniform = -1;
+    GLint spline_sampleScale_uniform = -1;   // 仅原始样本着色器
+    GLint spline_tangentScale_uniform = -1;
+    GLint spline_firstLaneReversed_uniform = -1;
+    std::vector<float> spline_upload; // 交错存放 (控制点, 切线)
+    std::vector<float> lane_scratch;  // 原始样本模式下 CPU 路径转换出的一条 lane
+    std::vector<float> spline_control_points; // compute_spline 的暂存，跨帧复用
+    std::vector<float> spline_tangents;
+    RenderMode render_mode = RenderMode::GpuSpline;
+    FrameStats frame_stats;
+    StartupTimes startup;
     // Cava 资源
-    std::vector<float> cava_frame;
-    size_t cava_bars = 64;
+    const void *cava_frame = nullptr;  // cava_reader_peek_raw 返回的零拷贝视图，cava_bars * cava_channels 个样本
+    cava_frame_info last_frame_info = {};
+    bool have_frame_info = false;
+    size_t cava_bars = 64;     // 每个声道的柱数
+    size_t cava_channels = 1;  // 1 = 单声道，2 = 立体声（每帧左右两条 lane）
+    ChannelLayout channel_layout = ChannelLayout::Mirrored;
     const char *bit_format = "16bit";
-    size_t ring_capacity = 16; // 环形缓冲区容量
+    size_t ring_capacity = 16; // 环形缓冲区容量（队列模式）
+    int ring_mode = CAVA_RING_LATEST; // 只呈现最新一帧
+    size_t pipe_size = 4096;   // 缩小 cava 管道，限制积压的旧帧
+    // 环形缓冲保存 cava 原始样本，GPU 路径直接上传为整数纹理在着色器中归一化
+    int sample_format = CAVA_SAMPLE_RAW;
+    size_t sample_bytes = 0;   // 启动后由 cava_reader_sample_bytes 填入
+    // 无线程模式：cava 管道由事件循环直接 poll 并在主线程上解析，省掉读取线程与每帧一次的跨线程唤醒。
+    // 设为 false 时改用独立的读取线程（下面的 reader_sched 只对它生效）
+    bool reader_threadless = true;
+    // 调度：默认都不改。reader_sched 只在 reader_threadless 为 false 时作用于读取线程，
+    // 例如 {SCHED_FIFO, 10, -5, 0} 尝试实时优先级，无权限时回退到 nice -5；无线程模式下读取在主线程上，
+    // 由 render_sched 决定
+    ThreadSched reader_sched;
+    ThreadSched render_sched;
+    bool lock_memory = false;  // mlockall，避免换页造成的卡顿
+    pid_t render_tid = 0;
+    ThreadSchedStats render_sched_last;    // 上一个统计窗口结束时的调度计数
+    ThreadSchedStats reader_sched_last;
     // 状态管理
     uint32_t configure_serial = 0;
     bool configured = false;
     bool egl_initialized = false;
+    wl_callback *frame_callback = nullptr; // 未完成的 wl_surface_frame 回调
+    bool frame_pending = false;            // 已提交一帧，等待 compositor 的 done
+    bool needs_redraw = false;             // 尺寸变化等需要重绘，即使没有新频谱帧
+    // 事件循环
+    int signal_fd = -1;                    // SIGINT/SIGTERM
+    int timer_fd = -1;                     // 帧回调期限
+    int late_deadlines = 0;                // 当前等待中的帧回调已错过的期限数
+    // 空闲时暂停 cava（SIGSTOP）：surface 不可见（帧回调超时或 closed）或持续静音，没人看得到输出
+    bool pause_cava_when_idle = true;
+    bool surface_hidden = false;
+    bool silent = false;                   // 已静音超过 silence_pause_ms
+    bool silence_probing = false;          // 静音暂停期间的探测窗口，cava 临时恢复
+    bool silence_run = false;              // 最近的帧都是静音
+    std::chrono::steady_clock::time_point silence_start;
+    bool cava_paused = false;
+    int probe_timer_fd = -1;               // 静音探测的间隔/窗口
+    // cava 帧率自适应（SIGUSR1 重新加载配置，不重启 cava）
+    bool adaptive_framerate = true;
+    unsigned cava_framerate = CAVA_FRAMERATE;
+    float level = 0.0f;                    // 帧峰值的指数平均，0..1
+    std::chrono::steady_clock::time_point framerate_changed;
     int width = 0;
     int height = 0;
     bool running = true;
@@ -113,6 +268,65 @@ static const wl_seat_listener seat_listener = {
     seat_capabilities
 };
 
+static void output_geometry(void *data, wl_output *output, int32_t x, int32_t y, int32_t physical_width,
+                            int32_t physical_height, int32_t subpixel, const char *make, const char *model,
+                            int32_t transform) {
+    // 忽略
+}
+
+static void output_mode(void *data, wl_output *output, uint32_t flags, int32_t width, int32_t height, int32_t refresh) {
+    ClientState *state = static_cast<ClientState *>(data);
+    if (!(flags & WL_OUTPUT_MODE_CURRENT)) {
+        return;
+    }
+    for (OutputInfo &info : state->outputs) {
+        if (info.output == output) {
+            info.refresh_mhz = refresh;
+        }
+    }
+}
+
+static void output_done(void *data, wl_output *output) {
+    // 忽略
+}
+
+static void output_scale(void *data, wl_output *output, int32_t factor) {
+    // 忽略
+}
+
+static const wl_output_listener output_listener = {
+    .geometry = output_geometry,
+    .mode = output_mode,
+    .done = output_done,
+    .scale = output_scale,
+};
+
+static void surface_enter(void *data, wl_surface *surface, wl_output *output) {
+    static_cast<ClientState *>(data)->surface_output = output;
+}
+
+static void surface_leave(void *data, wl_surface *surface, wl_output *output) {
+    ClientState *state = static_cast<ClientState *>(data);
+    if (state->surface_output == output) {
+        state->surface_output = nullptr;
+    }
+}
+
+static const wl_surface_listener surface_listener = {
+    .enter = surface_enter,
+    .leave = surface_leave,
+};
+
+// surface 所在输出的刷新率（Hz），只有一个输出时即为它；未知时返回 0
+static unsigned output_refresh_hz(const ClientState *state) {
+    for (const OutputInfo &info : state->outputs) {
+        if (info.output == state->surface_output || state->outputs.size() == 1) {
+            return static_cast<unsigned>((info.refresh_mhz + 500) / 1000);
+        }
+    }
+    return 0;
+}
+
 static void registry_global(void *data, struct wl_registry *registry, uint32_t id, const char *interface, uint32_t version) {
     ClientState *state = (ClientState *)data;
     if (strcmp(interface, wl_compositor_interface.name) == 0) {
@@ -141,10 +355,30 @@ static void registry_global(void *data, struct wl_registry *registry, uint32_t i
         wl_seat_add_listener(state->seat.get(), &seat_listener, state);
         std::cout << "[Wayland] Bound wl_seat" << std::endl;
     }
+    else if (strcmp(interface, wl_output_interface.name) == 0) {
+        OutputInfo info;
+        info.output = static_cast<wl_output*>(
+            wl_registry_bind(registry, id, &wl_output_interface, std::min<uint32_t>(version, 2))
+        );
+        info.name = id;
+        state->outputs.push_back(info);
+        wl_output_add_listener(info.output, &output_listener, state);
+        std::cout << "[Wayland] Bound wl_output" << std::endl;
+    }
 }
 
 static void registry_global_remove(void *data, struct wl_registry *registry, uint32_t id) {
-    // no-op
+    ClientState *state = static_cast<ClientState *>(data);
+    for (auto it = state->outputs.begin(); it != state->outputs.end(); ++it) {
+        if (it->name == id) {
+            if (state->surface_output == it->output) {
+                state->surface_output = nullptr;
+            }
+            wl_output_destroy(it->output);
+            state->outputs.erase(it);
+            return;
+        }
+    }
 }
 
 static const struct wl_registry_listener registry_listener = {
@@ -152,6 +386,34 @@ static const struct wl_registry_listener registry_listener = {
     .global_remove = registry_global_remove,
 };
 
+static void arm_timer_ms(int fd, long ms) {
+    itimerspec spec = {};
+    spec.it_value.tv_sec = ms / 1000;
+    spec.it_value.tv_nsec = (ms % 1000) * 1000000L;
+    timerfd_settime(fd, 0, &spec, nullptr);
+}
+
+// 按不可见/静音状态暂停或恢复 cava
+static void update_cava_pause(ClientState *state) {
+    bool want = state->pause_cava_when_idle &&
+                (state->surface_hidden || (state->silent && !state->silence_probing));
+    if (want == state->cava_paused) {
+        return;
+    }
+    if ((want ? cava_reader_pause() : cava_reader_resume()) == CAVA_OK) {
+        state->cava_paused = want;
+    }
+}
+
+static void set_surface_hidden(ClientState *state, bool hidden, const char *why) {
+    if (state->surface_hidden == hidden) {
+        return;
+    }
+    state->surface_hidden = hidden;
+    std::cout << "[CAVA] surface " << why << ", " << (hidden ? "pausing" : "resuming") << " cava" << std::endl;
+    update_cava_pause(state);
+}
+
 static void layer_surface_configure(void *data, struct zwlr_layer_surface_v1 *layer_surface, uint32_t serial, uint32_t width, uint32_t height) {
     ClientState *state = static_cast<ClientState *>(data);
     std::cout << "[Layer-Shell] 收到 configure 事件： 尺寸 " << width << "x" << height << ", 序列号 " << serial << std::endl;
@@ -159,6 +421,7 @@ static void layer_surface_configure(void *data, struct zwlr_layer_surface_v1 *la
     state->configured = true;
     state->width = width;
     state->height = height;
+    state->needs_redraw = true;
 
     if (!state->egl_initialized) {
         state->egl_window.reset(wl_egl_window_create(state->surface.get(), width, height));
@@ -178,6 +441,7 @@ static void layer_surface_closed(void *data, struct zwlr_layer_surface_v1 *layer
     ClientState *state = static_cast<ClientState *>(data);
     std::cout << "[Layer-Shell] 收到 closed 事件, 销毁 layer_surface" << std::endl;
     state->layer_surface.reset();
+    set_surface_hidden(state, true, "closed");
 }
 
 static const struct zwlr_layer_surface_v1_listener layer_surface_listener = {
@@ -185,59 +449,164 @@ static const struct zwlr_layer_surface_v1_listener layer_surface_listener = {
     .closed = layer_surface_closed,
 };
 
-GLuint compile_shader(GLenum type, const char *source) {
-    GLuint shader = glCreateShader(type);
-    glShaderSource(shader, 1, &source, nullptr);
-    glCompileShader(shader);
-
-    GLint compiled;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
-    if (!compiled) {
-        GLint log_len;
-        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &log_len);
-        std::vector<GLchar> log(log_len);
-        glGetShaderInfoLog(shader, log_len, nullptr, log.data());
-        std::cerr << "Failed to compile shader: " << log.data() << std::endl;
-        glDeleteShader(shader);
-        return 0;
+// 第一帧频谱呈现后输出一次冷启动各阶段耗时（time-to-first-pixel）
+static void report_startup(ClientState *state) {
+    using ms = std::chrono::duration<double, std::milli>;
+    StartupTimes &t = state->startup;
+    std::cout << "[Perf] startup: reader_start_ms=" << ms(t.reader_started).count()
+              << " configure_ms=" << ms(t.configured).count()
+              << " gl_ready_ms=" << ms(t.gl_ready).count()
+              << " first_frame_decoded_ms=" << ms(t.first_decoded).count()
+              << " first_swap_ms=" << ms(t.first_swap).count()
+              << " first_pixel_ms=" << ms(t.since_begin()).count() << std::endl;
+    t.reported = true;
+}
+
+static void frame_done(void *data, struct wl_callback *callback, uint32_t time) {
+    ClientState *state = static_cast<ClientState *>(data);
+    if (state->startup.swapped && !state->startup.reported) {
+        report_startup(state);
     }
+    wl_callback_destroy(callback);
+    state->frame_callback = nullptr;
+    state->frame_pending = false;
+    state->late_deadlines = 0;
+    arm_timer_ms(state->timer_fd, 0);
+    set_surface_hidden(state, false, "visible again");
+}
 
-    return shader;
+static const struct wl_callback_listener frame_listener = {
+    .done = frame_done,
+};
+
+// 空格分隔的扩展列表中是否包含 name（整词匹配）
+static bool has_extension(const char *extensions, const char *name) {
+    if (!extensions) return false;
+    size_t len = strlen(name);
+    for (const char *p = extensions; (p = strstr(p, name)) != nullptr; p += len) {
+        bool starts = p == extensions || p[-1] == ' ';
+        bool ends = p[len] == ' ' || p[len] == '\0';
+        if (starts && ends) return true;
+    }
+    return false;
 }
 
-bool create_shader_program(ClientState *state) {
-    GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER, vertex_shader_source);
-    GLuint fragment_shader = compile_shader(GL_FRAGMENT_SHADER, fragment_shader_source);
-    
-    if (!vertex_shader || !fragment_shader) {
-        return false;
+// 着色器程序分两步构建：start_program 只提交编译与链接，不查询结果；
+// finish_program 再检查状态。驱动支持 KHR_parallel_shader_compile 时编译在驱动线程进行，
+// 两步之间主线程可以继续处理 Wayland 事件。
+GLuint start_program(const char *vertex_source, const char *fragment_source) {
+    GLuint program = glCreateProgram();
+    const GLenum types[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+    const char *sources[2] = { vertex_source, fragment_source };
+    for (int i = 0; i < 2; ++i) {
+        GLuint shader = glCreateShader(types[i]);
+        glShaderSource(shader, 1, &sources[i], nullptr);
+        glCompileShader(shader);
+        glAttachShader(program, shader);
     }
-    
-    state->program = glCreateProgram();
-    glAttachShader(state->program, vertex_shader);
-    glAttachShader(state->program, fragment_shader);
-    glLinkProgram(state->program);
-    
+    glLinkProgram(program);
+    return program;
+}
+
+// 等待链接完成并检查结果；失败时输出着色器编译日志与链接日志并返回 0
+GLuint finish_program(GLuint program) {
     GLint success;
-    glGetProgramiv(state->program, GL_LINK_STATUS, &success);
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+
+    GLuint shaders[2];
+    GLsizei shader_count = 0;
+    glGetAttachedShaders(program, 2, &shader_count, shaders);
+    for (GLsizei i = 0; i < shader_count; ++i) {
+        GLint compiled;
+        glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &compiled);
+        if (!compiled) {
+            GLint log_len;
+            glGetShaderiv(shaders[i], GL_INFO_LOG_LENGTH, &log_len);
+            std::vector<GLchar> log(log_len > 0 ? log_len : 1, '\0');
+            glGetShaderInfoLog(shaders[i], static_cast<GLsizei>(log.size()), nullptr, log.data());
+            std::cerr << "Failed to compile shader: " << log.data() << std::endl;
+        }
+        glDetachShader(program, shaders[i]);
+        glDeleteShader(shaders[i]);
+    }
+
     if (!success) {
         GLchar info_log[512];
-        glGetProgramInfoLog(state->program, 512, nullptr, info_log);
+        glGetProgramInfoLog(program, 512, nullptr, info_log);
         std::cerr << "Shader program linking error: " << info_log << std::endl;
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    return program;
+}
+
+// 提交两个着色器程序的编译，需要当前上下文
+void start_shader_programs(ClientState *state) {
+    const char *gl_extensions = reinterpret_cast<const char *>(glGetString(GL_EXTENSIONS));
+    if (has_extension(gl_extensions, "GL_KHR_parallel_shader_compile")) {
+        auto max_threads = reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC>(
+            eglGetProcAddress("glMaxShaderCompilerThreadsKHR"));
+        if (max_threads) {
+            max_threads(0xFFFFFFFFu); // 线程数由驱动决定
+            state->parallel_shader_compile = true;
+        }
+    }
+    state->program = start_program(vertex_shader_source, fragment_shader_source);
+    state->spline_program = start_program(
+        state->sample_format == CAVA_SAMPLE_RAW ? spline_raw_vertex_shader_source : spline_vertex_shader_source,
+        fragment_shader_source);
+    state->shaders_started = true;
+    std::cout << "[EGL] Shader compile started"
+              << (state->parallel_shader_compile ? " (parallel)" : "") << std::endl;
+}
+
+// 取得编译结果并查询 attribute/uniform 位置
+bool finish_shader_programs(ClientState *state) {
+    if (!state->shaders_started) {
+        start_shader_programs(state);
+    }
+    if (state->parallel_shader_compile) {
+        GLint done = GL_FALSE;
+        glGetProgramiv(state->spline_program, GL_COMPLETION_STATUS_KHR, &done);
+        std::cout << "[EGL] Shaders " << (done ? "already compiled" : "still compiling") << " at configure" << std::endl;
+    }
+    state->program = finish_program(state->program);
+    state->spline_program = finish_program(state->spline_program);
+    if (!state->program || !state->spline_program) {
         return false;
     }
-    
     state->position_attr = glGetAttribLocation(state->program, "position");
     state->colorTop_uniform = glGetUniformLocation(state->program, "colorTop");
     state->colorBottom_uniform = glGetUniformLocation(state->program, "colorBottom");
-    
-    glDeleteShader(vertex_shader);
-    glDeleteShader(fragment_shader);
+
+    state->spline_colorTop_uniform = glGetUniformLocation(state->spline_program, "colorTop");
+    state->spline_colorBottom_uniform = glGetUniformLocation(state->spline_program, "colorBottom");
+    state->spline_screenHeight_uniform = glGetUniformLocation(state->spline_program, "screenHeight");
+    state->spline_pointCount_uniform = glGetUniformLocation(state->spline_program, "pointCount");
+    state->spline_pointsPerSegment_uniform = glGetUniformLocation(state->spline_program, "pointsPerSegment");
+    state->spline_controlPoints_uniform = glGetUniformLocation(
+        state->spline_program, state->sample_format == CAVA_SAMPLE_RAW ? "samples" : "controlPoints");
+    state->spline_mirrored_uniform = glGetUniformLocation(state->spline_program, "mirrored");
+    state->spline_sampleScale_uniform = glGetUniformLocation(state->spline_program, "sampleScale");
+    state->spline_tangentScale_uniform = glGetUniformLocation(state->spline_program, "tangentScale");
+    state->spline_firstLaneReversed_uniform = glGetUniformLocation(state->spline_program, "firstLaneReversed");
+
+    glGenTextures(1, &state->spline_texture);
+    glBindTexture(GL_TEXTURE_2D, state->spline_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
     
     return true;
 }
 
-bool init_egl(ClientState *state) {
+// EGL 初始化第一阶段，不需要 surface：display、config、context。
+// 在等待 compositor configure 时调用；支持 EGL_KHR_surfaceless_context 时
+// 先无 surface 绑定上下文并提交着色器编译，使编译与 configure 往返重叠。
+bool init_egl_context(ClientState *state) {
     state->egl_display = eglGetDisplay(state->display.get());
     if (state->egl_display == EGL_NO_DISPLAY) {
         std::cerr << "Failed to get EGL display" << std::endl;
@@ -263,37 +632,46 @@ bool init_egl(ClientState *state) {
         EGL_NONE
     };
 
-    EGLConfig config;
     EGLint num_configs;
-    if (!eglChooseConfig(state->egl_display, config_attribs, &config, 1, &num_configs)) {
+    if (!eglChooseConfig(state->egl_display, config_attribs, &state->egl_config, 1, &num_configs)) {
         std::cerr << "Failed to choose EGL config" << std::endl;
         return false;
     }
-    
-    state->egl_surface = eglCreateWindowSurface(
-        state->egl_display, 
-        config, 
-        (EGLNativeWindowType)state->egl_window.get(), 
-        nullptr
-    );
-    if (state->egl_surface == EGL_NO_SURFACE) {
-        std::cerr << "Failed to create EGL surface: " << eglGetError() << std::endl;
-        return false;
-    }
-    std::cout << "[EGL] Created EGL surface" << std::endl;
 
     EGLint context_attribs[] = { 
         EGL_CONTEXT_MAJOR_VERSION, 3,
         EGL_CONTEXT_MINOR_VERSION, 2,
         EGL_NONE
     };
-    state->egl_context = eglCreateContext(state->egl_display, config, EGL_NO_CONTEXT, context_attribs);
+    state->egl_context = eglCreateContext(state->egl_display, state->egl_config, EGL_NO_CONTEXT, context_attribs);
     if (state->egl_context == EGL_NO_CONTEXT) {
         std::cerr << "Failed to create EGL context: " << eglGetError() << std::endl;
         return false;
     }
     std::cout << "[EGL] Created EGL context" << std::endl;
 
+    const char *egl_extensions = eglQueryString(state->egl_display, EGL_EXTENSIONS);
+    if (has_extension(egl_extensions, "EGL_KHR_surfaceless_context") &&
+        eglMakeCurrent(state->egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, state->egl_context)) {
+        start_shader_programs(state);
+    }
+    return true;
+}
+
+// EGL 初始化第二阶段，收到 configure（egl_window 已创建）后调用
+bool init_egl_surface(ClientState *state) {
+    state->egl_surface = eglCreateWindowSurface(
+        state->egl_display, 
+        state->egl_config, 
+        (EGLNativeWindowType)state->egl_window.get(), 
+        nullptr
+    );
+    if (state->egl_surface == EGL_NO_SURFACE) {
+        std::cerr << "Failed to create EGL surface: " << eglGetError() << std::endl;
+        return false;
+    }
+    std::cout << "[EGL] Created EGL surface" << std::endl;
+
     if (!eglMakeCurrent(
         state->egl_display, 
         state->egl_surface, 
@@ -305,16 +683,30 @@ bool init_egl(ClientState *state) {
     }
     std::cout << "[EGL] Made EGL context current successfully" << std::endl;
 
-    if (!create_shader_program(state)) {
+    if (!finish_shader_programs(state)) {
         std::cerr << "Failed to create shader program" << std::endl;
         return false;
     }
-    glGenBuffers(1, &state->vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, state->vbo);
-    glEnableVertexAttribArray(state->position_attr);
-    glVertexAttribPointer(state->position_attr, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+    // 初始区域按 128 根柱子估算，不足时 stream_buffer_map 会扩容
+    size_t initial_region = spline_strip_vertices(CAVA_BARS_NUMBER) * 2 * sizeof(GLshort);
+    if (!stream_buffer_init(&state->vertex_stream, initial_region, vertex_stream_regions)) {
+        std::cerr << "Failed to create streaming vertex buffer" << std::endl;
+        return false;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    if (state->render_mode == RenderMode::GpuSpline && state->sample_format == CAVA_SAMPLE_RAW) {
+        // 一帧原始样本：128 柱立体声 16bit 为 512 字节，区域按 2 倍扩容，偏移保持样本对齐
+        size_t initial_upload = CAVA_BARS_NUMBER * 2 * sizeof(uint16_t);
+        if (!stream_buffer_init(&state->upload_stream, initial_upload, upload_stream_regions,
+                                GL_PIXEL_UNPACK_BUFFER)) {
+            std::cerr << "Failed to create pixel unpack buffer" << std::endl;
+            return false;
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
 
-    EGLint swap_interval = 1;
+    // 帧节奏由 wl_surface_frame 回调驱动，eglSwapBuffers 不再自行阻塞等待
+    EGLint swap_interval = 0;
     if (!eglSwapInterval(state->egl_display, swap_interval)) {
         std::cerr << "Failed to set swap interval: " << eglGetError() << std::endl;
         return false;
@@ -330,6 +722,239 @@ bool init_egl(ClientState *state) {
     return true;
 }
 
+// 当前帧第 lane 条 lane 的归一化样本（低频在前）。float 模式直接指向环形缓冲；
+// 原始样本模式（只有 CPU 细分需要 float）转换到 lane_scratch，下次调用前有效。
+// 原始立体声帧的左声道仍是 cava 的高频在前，转换时翻转
+static const float *lane_floats(ClientState *state, size_t lane) {
+    size_t n = state->cava_bars;
+    if (state->sample_format != CAVA_SAMPLE_RAW) {
+        return static_cast<const float *>(state->cava_frame) + lane * n;
+    }
+    state->lane_scratch.resize(n);
+    float *out = state->lane_scratch.data();
+    bool reversed = state->cava_channels == 2 && lane == 0;
+    for (size_t i = 0; i < n; i++) {
+        size_t src = lane * n + (reversed ? n - 1 - i : i);
+        out[i] = state->sample_bytes == 2
+            ? static_cast<const uint16_t *>(state->cava_frame)[src] * (1.0f / 65535.0f)
+            : static_cast<const uint8_t *>(state->cava_frame)[src] * (1.0f / 255.0f);
+    }
+    return out;
+}
+
+// 一个声道 lane 的 x 范围 [x_begin, x_end]：镜像布局下 lane 0 从中间向左，lane 1 从中间向右
+static void lane_x_range(const ClientState *state, size_t lane, float *x_begin, float *x_end) {
+    *x_begin = -1.0f;
+    *x_end = 1.0f;
+    if (state->cava_channels == 2 && state->channel_layout == ChannelLayout::Mirrored) {
+        *x_begin = 0.0f;
+        *x_end = lane == 0 ? -1.0f : 1.0f;
+    }
+}
+
+// CPU 细分：直接把三角带写入映射的流式缓冲区域，返回上传字节数。
+// 立体声时两条 lane 之间插入两个退化顶点（重复前一条的末顶点与后一条的首顶点），仍是一次绘制
+static size_t draw_spline_cpu(ClientState *state) {
+    size_t n = state->cava_bars;
+    size_t channels = state->cava_channels;
+    size_t lane_vertices = spline_strip_vertices(n);
+    size_t vertex_count = channels * lane_vertices + (channels - 1) * 2;
+    size_t bytes = vertex_count * 2 * sizeof(GLshort);
+    size_t offset = 0;
+    GLshort *vertices = static_cast<GLshort *>(stream_buffer_map(&state->vertex_stream, bytes, &offset));
+    if (!vertices) {
+        std::cerr << "Failed to map streaming vertex buffer" << std::endl;
+        return 0;
+    }
+    GLshort *out = vertices;
+    for (size_t lane = 0; lane < channels; lane++) {
+        GLshort *degenerate = nullptr;
+        if (lane > 0) {
+            out[0] = out[-2];
+            out[1] = out[-1];
+            degenerate = out + 2;
+            out += 4;
+        }
+        float x_begin, x_end;
+        lane_x_range(state, lane, &x_begin, &x_end);
+        GLshort *lane_start = out;
+        out = write_spline_strip(out, lane_floats(state, lane), n, x_begin, x_end, state->spline_control_points,
+                                 state->spline_tangents);
+        if (degenerate) {
+            degenerate[0] = lane_start[0];
+            degenerate[1] = lane_start[1];
+        }
+    }
+    stream_buffer_unmap(&state->vertex_stream);
+
+    // TODO: 设置更复杂的颜色渐变
+    glUseProgram(state->program);
+    GLint screenHeight_uniform = glGetUniformLocation(state->program, "screenHeight");
+    glUniform4f(state->colorTop_uniform, 0.0f, 0.4f, 1.0f, 0.4f);
+    glUniform4f(state->colorBottom_uniform, 0.0f, 1.0f, 0.4f, 0.4f);
+    glUniform1f(screenHeight_uniform, static_cast<float>(state->height));
+    glBindBuffer(GL_ARRAY_BUFFER, state->vertex_stream.buffer);
+    glEnableVertexAttribArray(state->position_attr);
+    glVertexAttribPointer(state->position_attr, 2, GL_SHORT, GL_TRUE, 0, reinterpret_cast<const void *>(offset));
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, vertex_count);
+    stream_buffer_fence(&state->vertex_stream);
+    glDisableVertexAttribArray(state->position_attr);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glUseProgram(0);
+
+    return bytes;
+}
+
+// GPU 细分：每个声道只上传 n 个 (控制点, 切线)，顶点着色器按 gl_VertexID 重建三角带，
+// 每个声道一个实例（纹理一行），立体声也只有一次绘制。
+// 原始样本模式直接把环形缓冲中的整数样本上传为 R16UI/R8UI 纹理，控制点与切线由着色器计算；
+// 样本先复制进像素解包缓冲的轮转区域，纹理更新由 GPU 从缓冲读取，驱动不必在调用时暂存客户端内存，
+// 也不会因上一帧仍在读取纹理而同步等待
+static size_t draw_spline_gpu(ClientState *state) {
+    size_t n = state->cava_bars;
+    size_t channels = state->cava_channels;
+    bool raw = state->sample_format == CAVA_SAMPLE_RAW;
+    size_t uploaded = 0;
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, state->spline_texture);
+    bool realloc = state->spline_texture_width != n || state->spline_texture_height != channels;
+    if (raw) {
+        bool wide = state->sample_bytes == 2;
+        GLenum type = wide ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE;
+        uploaded = n * channels * state->sample_bytes;
+        const void *pixels = state->cava_frame;
+        size_t offset = 0;
+        void *staging = stream_buffer_map(&state->upload_stream, uploaded, &offset);
+        if (staging) {
+            memcpy(staging, state->cava_frame, uploaded);
+            stream_buffer_unmap(&state->upload_stream);
+            // 绑定了 GL_PIXEL_UNPACK_BUFFER 时，像素指针是缓冲内的偏移
+            pixels = reinterpret_cast<const void *>(offset);
+        } else {
+            // 映射失败时退回客户端内存上传
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, wide ? 2 : 1);
+        if (realloc) {
+            glTexImage2D(GL_TEXTURE_2D, 0, wide ? GL_R16UI : GL_R8UI, n, channels, 0, GL_RED_INTEGER, type, pixels);
+        } else {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, n, channels, GL_RED_INTEGER, type, pixels);
+        }
+        if (staging) {
+            stream_buffer_fence(&state->upload_stream);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+    } else {
+        state->spline_upload.resize(n * channels * 2);
+        for (size_t lane = 0; lane < channels; lane++) {
+            pack_spline_points(lane_floats(state, lane), n, state->spline_control_points, state->spline_tangents,
+                               state->spline_upload.data() + lane * n * 2);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        if (realloc) {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, n, channels, 0, GL_RG, GL_FLOAT, state->spline_upload.data());
+        } else {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, n, channels, GL_RG, GL_FLOAT, state->spline_upload.data());
+        }
+        uploaded = state->spline_upload.size() * sizeof(float);
+    }
+    state->spline_texture_width = n;
+    state->spline_texture_height = channels;
+
+    // 每段 points_per_segment + 1 列，加上最后一个控制点；每列上下两个顶点
+    GLsizei columns = static_cast<GLsizei>((n - 1) * (spline_points_per_segment + 1) + 1);
+    bool mirrored = channels == 2 && state->channel_layout == ChannelLayout::Mirrored;
+
+    glUseProgram(state->spline_program);
+    glUniform4f(state->spline_colorTop_uniform, 0.0f, 0.4f, 1.0f, 0.4f);
+    glUniform4f(state->spline_colorBottom_uniform, 0.0f, 1.0f, 0.4f, 0.4f);
+    glUniform1f(state->spline_screenHeight_uniform, static_cast<float>(state->height));
+    glUniform1i(state->spline_pointCount_uniform, static_cast<GLint>(n));
+    glUniform1i(state->spline_pointsPerSegment_uniform, static_cast<GLint>(spline_points_per_segment));
+    glUniform1i(state->spline_controlPoints_uniform, 0);
+    glUniform1i(state->spline_mirrored_uniform, mirrored ? 1 : 0);
+    if (raw) {
+        glUniform1f(state->spline_sampleScale_uniform, state->sample_bytes == 2 ? 1.0f / 65535.0f : 1.0f / 255.0f);
+        glUniform1f(state->spline_tangentScale_uniform, (1.0f - spline_tension) / 2.0f);
+        glUniform1i(state->spline_firstLaneReversed_uniform, channels == 2 ? 1 : 0);
+    }
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, columns * 2, static_cast<GLsizei>(channels));
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+
+    return uploaded;
+}
+
+// 周期性输出每帧 CPU 准备/上传耗时与上传量
+static void report_frame_stats(ClientState *state) {
+    FrameStats &stats = state->frame_stats;
+    auto now = std::chrono::steady_clock::now();
+    auto elapsed = now - stats.window_start;
+    if (elapsed < std::chrono::seconds(5)) {
+        return;
+    }
+    if (stats.frames > 0) {
+        double secs = std::chrono::duration<double>(elapsed).count();
+        struct cava_reader_stats cava_stats;
+        cava_reader_stats(&cava_stats);
+        std::cout << "[Perf] " << (state->render_mode == RenderMode::GpuSpline ? "gpu-spline" : "cpu-spline")
+                  << " bars=" << state->cava_bars
+                  << " channels=" << state->cava_channels
+                  << " fps=" << static_cast<double>(stats.frames) / secs
+                  << " wakeups/s=" << static_cast<double>(stats.wakeups) / secs
+                  << " missed_deadlines=" << stats.missed_deadlines
+                  << " cava_frames=" << cava_stats.frames_received
+                  << " dropped=" << cava_stats.frames_dropped
+                  << " superseded=" << cava_stats.frames_superseded
+                  << " short_reads=" << cava_stats.short_reads
+                  << " eintr=" << cava_stats.eintr_retries
+                  << " decode_ns=" << cava_stats.decode_ns_last
+                  << " ring_hwm=" << cava_stats.ring_high_water << "/" << cava_stats.ring_capacity
+                  << " frame_age_us=" << cava_stats.frame_age_ns / 1000
+                  << " cava_restarts=" << cava_stats.restarts
+                  << " cava_downtime_ms=" << cava_stats.downtime_ns / 1000000
+                  << " cava_paused_ms=" << cava_stats.paused_ns / 1000000
+                  << " cava_fps=" << cava_stats.framerate
+                  << " cava_reloads=" << cava_stats.reloads
+                  << " last_frame_ms=" << (cava_stats.ns_since_last_frame == UINT64_MAX
+                                               ? -1.0 : cava_stats.ns_since_last_frame / 1e6)
+                  << " seq_gaps=" << stats.seq_gaps
+                  << " cpu_us/frame=" << static_cast<double>(stats.prepare_ns) / stats.frames / 1000.0
+                  << " upload_bytes/frame=" << stats.upload_bytes / stats.frames;
+        // 平均每次获得 CPU 前在运行队列中等待的时间
+        ThreadSchedStats reader_sched;
+        reader_sched.wait_ns = cava_stats.sched_wait_ns;
+        reader_sched.slices = cava_stats.sched_slices;
+        ThreadSchedStats render_sched;
+        if (reader_sched.slices) {
+            std::cout << " reader_sched_wait_us="
+                      << thread_sched_wait_per_slice(&state->reader_sched_last, &reader_sched) / 1000.0;
+            state->reader_sched_last = reader_sched;
+        }
+        if (thread_sched_stats(state->render_tid, &render_sched)) {
+            std::cout << " render_sched_wait_us="
+                      << thread_sched_wait_per_slice(&state->render_sched_last, &render_sched) / 1000.0;
+            state->render_sched_last = render_sched;
+        }
+        if (stats.intervals > 1) {
+            double mean = stats.interval_sum_ms / stats.intervals;
+            double var = stats.interval_sq_sum_ms / stats.intervals - mean * mean;
+            std::cout << " arrival_ms=" << mean << " jitter_ms=" << std::sqrt(var > 0.0 ? var : 0.0);
+        }
+        if (state->render_mode == RenderMode::CpuSpline || state->upload_stream.buffer) {
+            const StreamBuffer &sb = state->render_mode == RenderMode::CpuSpline ? state->vertex_stream
+                                                                                 : state->upload_stream;
+            std::cout << " stream_stalls=" << sb.stalls
+                      << " stream_stall_us=" << sb.stall_ns / 1000
+                      << " stream_reallocs=" << sb.reallocs;
+        }
+        std::cout << std::endl;
+    }
+    stats = FrameStats();
+    stats.window_start = now;
+}
+
 void draw_frame(ClientState *state) {
     if (!state->egl_initialized) {
         std::cerr << "EGL not initialized" << std::endl;
@@ -344,103 +969,281 @@ void draw_frame(ClientState *state) {
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
     glClear(GL_COLOR_BUFFER_BIT);
 
-    int ret = cava_reader_try_pop(state->cava_frame.data(), state->cava_frame.size());
-    if (ret >= 0) {
-        size_t n = state->cava_frame.size();
-        if (n < 2) return;
-
-        // Cardinal spline
-        const float tension = 0.5f;
-        const size_t points_per_segment = 128;
-        std::vector<GLfloat> vertices;
-        std::vector<float> control_points(n);
-
-        std::vector<float> x_coords(n);
-        for (size_t i = 0; i < n; i++) {
-            x_coords[i] = -1.0f + 2.0f * static_cast<float>(i) / static_cast<float>(n - 1);
-            control_points[i] = state->cava_frame[i] * 2.0f - 1.0f;
-        }
-
-        std::vector<float> tangents(n);
-        for (size_t i = 0; i < n - 1; i++) {
-            if (i == 0) {
-                tangents[i] = (1.0f - tension) / 2.0f * (control_points[1] - control_points[0]);
-            } else if (i == n - 1) {
-                tangents[i] = (1.0f - tension) / 2.0f * (control_points[n - 1] - control_points[n - 2]);
-            } else {
-                tangents[i] = (1.0f - tension) / 2.0f * (control_points[i + 1] - control_points[i - 1]);
+    size_t n = state->cava_bars;
+    if (n < 2 || !state->cava_frame) return;
+
+    auto prepare_start = std::chrono::steady_clock::now();
+    size_t uploaded = state->render_mode == RenderMode::GpuSpline
+        ? draw_spline_gpu(state)
+        : draw_spline_cpu(state);
+    auto prepare_end = std::chrono::steady_clock::now();
+
+    state->frame_stats.frames++;
+    state->frame_stats.upload_bytes += uploaded;
+    state->frame_stats.prepare_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(prepare_end - prepare_start).count();
+    report_frame_stats(state);
+
+    glFlush();
+
+    // 在交换前请求帧回调，使其随 eglSwapBuffers 的 commit 一起提交
+    state->frame_callback = wl_surface_frame(state->surface.get());
+    wl_callback_add_listener(state->frame_callback, &frame_listener, state);
+    state->frame_pending = true;
+    state->needs_redraw = false;
+    arm_timer_ms(state->timer_fd, frame_deadline_ms);
+
+    // 交换缓冲区
+    eglSwapBuffers(state->egl_display, state->egl_surface);
+    if (!state->startup.swapped) {
+        state->startup.first_swap = state->startup.since_begin();
+        state->startup.swapped = true;
+    }
+}
+
+// 取到最新一帧的零拷贝视图（每次成功的 peek 会释放上一个视图）。返回是否取到新帧。
+static bool pop_latest_frame(ClientState *state) {
+    bool got = false;
+    const void *frame = nullptr;
+    cava_frame_info info;
+    while (cava_reader_peek_raw(&frame, &info) == 1) {
+        FrameStats &stats = state->frame_stats;
+        if (state->have_frame_info && info.seq > state->last_frame_info.seq) {
+            stats.seq_gaps += info.seq - state->last_frame_info.seq - 1;
+            if (info.arrival_ns > state->last_frame_info.arrival_ns) {
+                // 按帧序号差归一化，跳过的帧不会被算作到达间隔变长
+                double ms = static_cast<double>(info.arrival_ns - state->last_frame_info.arrival_ns) / 1e6
+                          / static_cast<double>(info.seq - state->last_frame_info.seq);
+                stats.intervals++;
+                stats.interval_sum_ms += ms;
+                stats.interval_sq_sum_ms += ms * ms;
             }
         }
+        if (!state->have_frame_info) {
+            // arrival_ns 来自 CLOCK_MONOTONIC，与 Linux 上的 steady_clock 同一时钟
+            std::chrono::steady_clock::time_point decoded{std::chrono::nanoseconds(info.arrival_ns)};
+            state->startup.first_decoded = decoded - state->startup.begin;
+        }
+        state->cava_frame = frame;
+        state->last_frame_info = info;
+        state->have_frame_info = true;
+        got = true;
+    }
+    return got;
+}
 
-        vertices.reserve((n + (n - 1) * points_per_segment) * 4);
-        for (size_t i = 0; i < n - 1; i++) {
-            float x0 = x_coords[i];
-            float x1 = x_coords[i + 1];
-            float y0 = control_points[i];
-            float y1 = control_points[i + 1];
-            float m0 = tangents[i];
-            float m1 = tangents[i + 1];
-
-            vertices.push_back(x0);
-            vertices.push_back(-1.0f);
-            vertices.push_back(x0);
-            vertices.push_back(y0);
-
-            for (size_t j = 1; j <= points_per_segment; j++) {
-                float u = static_cast<float>(j) / static_cast<float>(points_per_segment + 1);
-                float h0 = 2.0f * u * u * u - 3.0f * u * u + 1.0f;
-                float h1 = -2.0f * u * u * u + 3.0f * u * u;
-                float h2 = u * u * u - 2.0f * u * u + u;
-                float h3 = u * u * u - u * u;
-
-                float x = x0 + u * (x1 - x0);
-                float y = h0 * y0 + h1 * y1 + h2 * m0 + h3 * m1;
-
-                vertices.push_back(x);
-                vertices.push_back(-1.0f);
-                vertices.push_back(x);
-                vertices.push_back(y);
-            }
+// 整帧为 0（float 的 0.0f 也是全 0 字节）
+static bool frame_is_silent(const ClientState *state) {
+    const uint8_t *bytes = static_cast<const uint8_t *>(state->cava_frame);
+    size_t size = state->cava_bars * state->cava_channels * state->sample_bytes;
+    for (size_t i = 0; i < size; i++) {
+        if (bytes[i]) {
+            return false;
         }
+    }
+    return true;
+}
+
+// 最新一帧的峰值，归一化到 0..1
+static float frame_peak(const ClientState *state) {
+    size_t count = state->cava_bars * state->cava_channels;
+    float peak = 0.0f;
+    if (state->sample_bytes == 1) {
+        const uint8_t *samples = static_cast<const uint8_t *>(state->cava_frame);
+        for (size_t i = 0; i < count; i++) {
+            peak = std::max(peak, samples[i] / 255.0f);
+        }
+    } else if (state->sample_bytes == 2) {
+        const uint16_t *samples = static_cast<const uint16_t *>(state->cava_frame);
+        for (size_t i = 0; i < count; i++) {
+            peak = std::max(peak, samples[i] / 65535.0f);
+        }
+    } else {
+        const float *samples = static_cast<const float *>(state->cava_frame);
+        for (size_t i = 0; i < count; i++) {
+            peak = std::max(peak, samples[i]);
+        }
+    }
+    return peak;
+}
 
-        vertices.push_back(x_coords[n - 1]);
-        vertices.push_back(-1.0f);
-        vertices.push_back(x_coords[n - 1]);
-        vertices.push_back(control_points[n - 1]);
+// 按平滑后的电平、surface 宽度与输出刷新率调整 cava 帧率：响亮时跟上显示，安静或很小时减少分析
+static void update_cava_framerate(ClientState *state) {
+    state->level += (frame_peak(state) - state->level) * level_smoothing;
+    if (!state->adaptive_framerate) {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (now - state->framerate_changed < std::chrono::milliseconds(framerate_hold_ms)) {
+        return;
+    }
+    unsigned refresh = output_refresh_hz(state);
+    unsigned loud_rate = refresh ? std::min<unsigned>(refresh, CAVA_FRAMERATE_MAX) : CAVA_FRAMERATE;
+    unsigned target = state->cava_framerate;
+    if (state->width < small_surface_width || state->level < quiet_level) {
+        target = std::min(quiet_framerate, loud_rate);
+    } else if (state->level > loud_level) {
+        target = loud_rate;
+    }
+    if (target == state->cava_framerate) {
+        return;
+    }
+    if (cava_reader_set_framerate(target) == CAVA_OK) {
+        std::cout << "[CAVA] framerate " << state->cava_framerate << " -> " << target
+                  << " (level " << state->level << ", refresh " << refresh << " Hz)" << std::endl;
+        state->cava_framerate = target;
+        state->framerate_changed = now;
+    }
+}
 
-        // TODO: 设置更复杂的颜色渐变
-        glUseProgram(state->program);
-        GLint screenHeight_uniform = glGetUniformLocation(state->program, "screenHeight");
-        glUniform4f(state->colorTop_uniform, 0.0f, 0.4f, 1.0f, 0.4f);
-        glUniform4f(state->colorBottom_uniform, 0.0f, 1.0f, 0.4f, 0.4f);
-        glUniform1f(screenHeight_uniform, static_cast<float>(state->height));
-        glBindBuffer(GL_ARRAY_BUFFER, state->vbo);
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), vertices.data(), GL_STATIC_DRAW);
-        glEnableVertexAttribArray(state->position_attr);
-        glVertexAttribPointer(state->position_attr, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
-        glDrawArrays(GL_TRIANGLE_STRIP, 0, vertices.size() / 2);
-        glDisableVertexAttribArray(state->position_attr);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glUseProgram(0);
+// 按最新一帧更新静音状态：静音持续 silence_pause_ms 后暂停 cava 并开始周期性探测，有声音立即恢复
+static void note_frame_level(ClientState *state) {
+    if (!frame_is_silent(state)) {
+        state->silence_run = false;
+        if (state->silent) {
+            state->silent = false;
+            state->silence_probing = false;
+            arm_timer_ms(state->probe_timer_fd, 0);
+            std::cout << "[CAVA] sound is back, resuming cava" << std::endl;
+            update_cava_pause(state);
+        }
+        return;
     }
+    auto now = std::chrono::steady_clock::now();
+    if (!state->silence_run) {
+        state->silence_run = true;
+        state->silence_start = now;
+        return;
+    }
+    if (!state->silent && now - state->silence_start >= std::chrono::milliseconds(silence_pause_ms)) {
+        state->silent = true;
+        state->silence_probing = false;
+        arm_timer_ms(state->probe_timer_fd, silence_probe_interval_ms);
+        std::cout << "[CAVA] silent for " << silence_pause_ms << " ms, pausing cava" << std::endl;
+        update_cava_pause(state);
+    }
+}
 
-    glFlush();
+// 统一事件循环：Wayland fd、cava fd、signalfd 与帧期限 timerfd。
+// 无事可做时主线程阻塞在 poll 中。使用读取线程时只在帧回调已到达时才关注 cava 就绪 fd，
+// 因此 surface 不可见时新频谱帧不会唤醒主线程；无线程模式下 cava fd 就是管道本身，
+// 必须一直排空（否则 cava 会阻塞在写入上，管道里积压旧帧），解析出的帧留到帧回调到达后再绘制。
+static void run_event_loop(ClientState *state) {
+    wl_display *display = state->display.get();
+    enum { FD_DISPLAY, FD_SIGNAL, FD_TIMER, FD_CAVA, FD_PROBE, FD_COUNT };
 
-    // 交换缓冲区
-    eglSwapBuffers(state->egl_display, state->egl_surface);
+    while (state->running) {
+        state->frame_stats.wakeups++;
+
+        while (wl_display_prepare_read(display) != 0) {
+            wl_display_dispatch_pending(display);
+        }
+        wl_display_flush(display);
+
+        pollfd fds[FD_COUNT] = {};
+        fds[FD_DISPLAY] = { wl_display_get_fd(display), POLLIN, 0 };
+        fds[FD_SIGNAL] = { state->signal_fd, POLLIN, 0 };
+        fds[FD_TIMER] = { state->timer_fd, POLLIN, 0 };
+        bool watch_cava = state->reader_threadless || !state->frame_pending;
+        fds[FD_CAVA] = { watch_cava ? cava_reader_fd() : -1, POLLIN, 0 };
+        fds[FD_PROBE] = { state->probe_timer_fd, POLLIN, 0 };
+
+        if (poll(fds, FD_COUNT, -1) < 0) {
+            wl_display_cancel_read(display);
+            if (errno == EINTR) continue;
+            std::cerr << "poll failed: " << strerror(errno) << std::endl;
+            break;
+        }
 
-    wl_surface_commit(state->surface.get());
+        if (fds[FD_DISPLAY].revents & POLLIN) {
+            if (wl_display_read_events(display) < 0) {
+                std::cerr << "Lost connection to Wayland display" << std::endl;
+                break;
+            }
+        } else {
+            wl_display_cancel_read(display);
+        }
+        if (fds[FD_DISPLAY].revents & (POLLERR | POLLHUP)) {
+            std::cerr << "Wayland display hung up" << std::endl;
+            break;
+        }
+        wl_display_dispatch_pending(display);
+
+        if (fds[FD_SIGNAL].revents & POLLIN) {
+            signalfd_siginfo info;
+            if (read(state->signal_fd, &info, sizeof(info)) == sizeof(info)) {
+                std::cout << "[Loop] Received signal " << info.ssi_signo << ", exiting..." << std::endl;
+            }
+            state->running = false;
+            break;
+        }
+
+        if (fds[FD_TIMER].revents & POLLIN) {
+            uint64_t expirations = 0;
+            if (read(state->timer_fd, &expirations, sizeof(expirations)) == sizeof(expirations) && state->frame_pending) {
+                // 每个迟到的帧回调只计一次；未满 hidden_after_missed_deadlines 时继续等下一个期限，
+                // 已判定为不可见后不再重新计时，等帧回调到达
+                if (++state->late_deadlines == 1) {
+                    state->frame_stats.missed_deadlines++;
+                }
+                if (state->late_deadlines >= hidden_after_missed_deadlines) {
+                    set_surface_hidden(state, true, "not being shown");
+                } else {
+                    arm_timer_ms(state->timer_fd, frame_deadline_ms);
+                }
+            }
+        }
+
+        if (fds[FD_PROBE].revents & POLLIN) {
+            uint64_t expirations = 0;
+            if (read(state->probe_timer_fd, &expirations, sizeof(expirations)) == sizeof(expirations) && state->silent) {
+                // 在探测窗口与暂停间隔之间交替
+                state->silence_probing = !state->silence_probing;
+                arm_timer_ms(state->probe_timer_fd,
+                             state->silence_probing ? silence_probe_window_ms : silence_probe_interval_ms);
+                update_cava_pause(state);
+            }
+        }
+
+        if (fds[FD_CAVA].revents & POLLIN) {
+            if (state->reader_threadless) {
+                cava_reader_service();
+            } else {
+                uint64_t count = 0;
+                ssize_t r = read(fds[FD_CAVA].fd, &count, sizeof(count));
+                (void)r;
+            }
+        }
+
+        if (!state->frame_pending) {
+            bool fresh = pop_latest_frame(state);
+            if (fresh) {
+                note_frame_level(state);
+                update_cava_framerate(state);
+            }
+            if (fresh || state->needs_redraw) {
+                draw_frame(state);
+            }
+        }
+    }
 }
 
 void cleanup_egl(ClientState *state) {
-    if (state->vbo) {
-        glDeleteBuffers(1, &state->vbo);
-        state->vbo = 0;
-    }
+    stream_buffer_destroy(&state->vertex_stream);
+    stream_buffer_destroy(&state->upload_stream);
     if (state->program) {
         glDeleteProgram(state->program);
         state->program = 0;
     }
+    if (state->spline_program) {
+        glDeleteProgram(state->spline_program);
+        state->spline_program = 0;
+    }
+    if (state->spline_texture) {
+        glDeleteTextures(1, &state->spline_texture);
+        state->spline_texture = 0;
+        state->spline_texture_width = 0;
+        state->spline_texture_height = 0;
+    }
     if (state->egl_display != EGL_NO_DISPLAY) {
         eglMakeCurrent(state->egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
         
@@ -464,6 +1267,67 @@ void cleanup_egl(ClientState *state) {
 
 int main() {
     ClientState state;
+
+    // 在启动任何线程或子进程之前屏蔽 SIGINT/SIGTERM，由事件循环通过 signalfd 处理
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    if (sigprocmask(SIG_BLOCK, &mask, nullptr) != 0) {
+        std::cerr << "Failed to block signals" << std::endl;
+        return 1;
+    }
+    state.signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    state.timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    state.probe_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (state.signal_fd < 0 || state.timer_fd < 0 || state.probe_timer_fd < 0) {
+        std::cerr << "Failed to create signalfd/timerfd" << std::endl;
+        return 1;
+    }
+
+    if (state.lock_memory && !thread_sched_lock_memory()) {
+        std::cerr << "mlockall failed, continuing without locked memory" << std::endl;
+    }
+
+    // cava 最先启动：它的预热（音频采集、首帧）与下面的 Wayland/EGL 初始化并行进行
+    cava_reader_options cava_opts;
+    cava_reader_options_init(&cava_opts);
+    cava_opts.bit_format = state.bit_format;
+    cava_opts.bars_number = state.cava_bars;
+    cava_opts.channels = static_cast<int>(state.cava_channels);
+    cava_opts.ring_capacity = state.ring_capacity;
+    cava_opts.ring_mode = state.ring_mode;
+    cava_opts.pipe_size = state.pipe_size;
+    cava_opts.sample_format = state.sample_format;
+    cava_opts.sched_policy = state.reader_sched.policy;
+    cava_opts.sched_priority = state.reader_sched.priority;
+    cava_opts.sched_nice = state.reader_sched.nice;
+    cava_opts.cpu_affinity = state.reader_sched.cpu_mask;
+    cava_opts.threadless = state.reader_threadless ? 1 : 0;
+    cava_opts.framerate = state.cava_framerate;
+    if (cava_reader_start_ex(&cava_opts) != CAVA_OK) {
+        std::cerr << "无法启动 cava_reader" << std::endl;
+        return 1;
+    }
+    state.startup.reader_started = state.startup.since_begin();
+    state.sample_bytes = cava_reader_sample_bytes();
+    // 启动阶段电平还没有积累起来，先保持初始帧率
+    state.framerate_changed = std::chrono::steady_clock::now();
+    std::cout << "[CAVA] Reader started with " << state.cava_bars << " bars x "
+              << state.cava_channels << " channel(s)" << std::endl;
+
+    // 渲染线程的调度在 cava 启动之后设置，首个 cava 子进程不受影响
+    state.render_tid = thread_sched_tid();
+    const ThreadSched &rs = state.render_sched;
+    if (rs.policy != SCHED_OTHER || rs.nice != 0 || rs.cpu_mask) {
+        int applied = thread_sched_apply(&rs);
+        std::cout << "[Sched] render thread:"
+                  << ((applied & THREAD_SCHED_APPLIED_RT) ? " real-time" : "")
+                  << ((applied & THREAD_SCHED_APPLIED_NICE) ? " nice" : "")
+                  << ((applied & THREAD_SCHED_APPLIED_AFFINITY) ? " affinity" : "")
+                  << (applied ? "" : " unchanged (permission denied)") << std::endl;
+    }
+
     state.display.reset(wl_display_connect(nullptr));
     if (!state.display) {
         std::cerr << "Failed to connect to Wayland display" << std::endl;
@@ -491,6 +1355,7 @@ int main() {
         std::cerr << "Failed to create surface" << std::endl;
         return 1;
     }
+    wl_surface_add_listener(state.surface.get(), &surface_listener, &state);
     std::cout << "[Wayland] Created surface" << std::endl;
 
     state.layer_surface.reset(zwlr_layer_shell_v1_get_layer_surface(
@@ -512,38 +1377,50 @@ int main() {
 
     // 首次提交：触发 compositor 发送 configure 事件
     wl_surface_commit(state.surface.get());
+    wl_display_flush(state.display.get());
     std::cout << "[Wayland] 首次提交 surface" << std::endl;
+
+    // configure 往返进行期间初始化 EGL 上下文并提交着色器编译
+    if (!init_egl_context(&state)) {
+        std::cerr << "Failed to initialize EGL" << std::endl;
+        return 1;
+    }
+
     // 等待 compositor 配置
     while (!state.configured) {
         wl_display_dispatch(state.display.get());
     }
+    state.startup.configured = state.startup.since_begin();
     std::cout << "[Layer-Shell] compositor 配置完成" << std::endl;
 
-    // 初始化 EGL
-    if (!init_egl(&state)) {
+    if (!init_egl_surface(&state)) {
         std::cerr << "Failed to initialize EGL" << std::endl;
         return 1;
     }
-
-    state.cava_frame.resize(state.cava_bars);
-    if (cava_reader_start(state.bit_format, state.cava_bars, state.ring_capacity) != CAVA_OK) {
-        std::cerr << "无法启动 cava_reader" << std::endl;
-        return 1;
-    }
-    std::cout << "[CAVA] Reader started with " << state.cava_bars << " bars" << std::endl;
+    state.startup.gl_ready = state.startup.since_begin();
 
     // 主渲染循环
     std::cout << "[Layer-Shell] 客户端运行中" << std::endl;
-    while (state.running) {
-        wl_display_dispatch_pending(state.display.get());
-        wl_display_flush(state.display.get());
-        draw_frame(&state);
+    // 只在 compositor 的帧回调到达且有新频谱帧（或需要重绘）时绘制，每个 vblank 至多一次
+    run_event_loop(&state);
+    if (state.frame_callback) {
+        wl_callback_destroy(state.frame_callback);
+        state.frame_callback = nullptr;
     }
 
     // 清理资源
+    cava_reader_release();
+    state.cava_frame = nullptr;
     cava_reader_stop();
     cleanup_egl(&state);
     std::cout << "[CAVA] Reader stopped" << std::endl;
+    close(state.timer_fd);
+    close(state.probe_timer_fd);
+    close(state.signal_fd);
+    for (OutputInfo &info : state.outputs) {
+        wl_output_destroy(info.output);
+    }
+    state.outputs.clear();
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include <math.h>
+
+#include "spline.hpp"
+
+void compute_spline(const float *frame, size_t n, std::vector<float> &control_points, std::vector<float> &tangents) {
+    const float tension = spline_tension;
+    control_points.resize(n);
+    tangents.assign(n, 0.0f);
+    for (size_t i = 0; i < n; i++) {
+        control_points[i] = frame[i] * 2.0f - 1.0f;
+    }
+    for (size_t i = 0; i < n - 1; i++) {
+        if (i == 0) {
+            tangents[i] = (1.0f - tension) / 2.0f * (control_points[1] - control_points[0]);
+        } else if (i == n - 1) {
+            tangents[i] = (1.0f - tension) / 2.0f * (control_points[n - 1] - control_points[n - 2]);
+        } else {
+            tangents[i] = (1.0f - tension) / 2.0f * (control_points[i + 1] - control_points[i - 1]);
+        }
+    }
+}
+
+size_t spline_strip_vertices(size_t n) {
+    return ((n - 1) * (spline_points_per_segment + 1) + 1) * 2;
+}
+
+// 顶点坐标量化为 GL_SHORT 归一化值；超出 [-1, 1] 的部分本就位于裁剪空间之外
+static inline int16_t quantize_ndc(float v) {
+    if (v > 1.0f) v = 1.0f;
+    if (v < -1.0f) v = -1.0f;
+    return static_cast<int16_t>(lrintf(v * 32767.0f));
+}
+
+// 第 i 个控制点的 x：在 [x_begin, x_end] 上均匀分布
+static inline float control_x(size_t i, size_t n, float x_begin, float x_end) {
+    return x_begin + (x_end - x_begin) * static_cast<float>(i) / static_cast<float>(n - 1);
+}
+
+int16_t *write_spline_strip(int16_t *out, const float *lane, size_t n, float x_begin, float x_end,
+                            std::vector<float> &control_points, std::vector<float> &tangents) {
+    const size_t points_per_segment = spline_points_per_segment;
+    compute_spline(lane, n, control_points, tangents);
+
+    const int16_t bottom = quantize_ndc(-1.0f);
+    for (size_t i = 0; i < n - 1; i++) {
+        float x0 = control_x(i, n, x_begin, x_end);
+        float x1 = control_x(i + 1, n, x_begin, x_end);
+        float y0 = control_points[i];
+        float y1 = control_points[i + 1];
+        float m0 = tangents[i];
+        float m1 = tangents[i + 1];
+
+        int16_t qx0 = quantize_ndc(x0);
+        *out++ = qx0;
+        *out++ = bottom;
+        *out++ = qx0;
+        *out++ = quantize_ndc(y0);
+
+        for (size_t j = 1; j <= points_per_segment; j++) {
+            float u = static_cast<float>(j) / static_cast<float>(points_per_segment + 1);
+            float h0 = 2.0f * u * u * u - 3.0f * u * u + 1.0f;
+            float h1 = -2.0f * u * u * u + 3.0f * u * u;
+            float h2 = u * u * u - 2.0f * u * u + u;
+            float h3 = u * u * u - u * u;
+
+            float x = x0 + u * (x1 - x0);
+            float y = h0 * y0 + h1 * y1 + h2 * m0 + h3 * m1;
+
+            int16_t qx = quantize_ndc(x);
+            *out++ = qx;
+            *out++ = bottom;
+            *out++ = qx;
+            *out++ = quantize_ndc(y);
+        }
+    }
+
+    int16_t qxn = quantize_ndc(control_x(n - 1, n, x_begin, x_end));
+    *out++ = qxn;
+    *out++ = bottom;
+    *out++ = qxn;
+    *out++ = quantize_ndc(control_points[n - 1]);
+    return out;
+}
+
+void pack_spline_points(const float *lane, size_t n, std::vector<float> &control_points,
+                        std::vector<float> &tangents, float *row) {
+    compute_spline(lane, n, control_points, tangents);
+    for (size_t i = 0; i < n; i++) {
+        row[i * 2] = control_points[i];
+        row[i * 2 + 1] = tangents[i];
+    }
+}
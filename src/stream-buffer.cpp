@@ -0,0 +1,102 @@
+#include <chrono>
+
+#include "stream-buffer.hpp"
+
+static void wait_fence(StreamBuffer *sb, size_t region) {
+    GLsync fence = sb->fences[region];
+    if (!fence) return;
+    // 先非阻塞查询；只有 GPU 仍在读取该区域时才计为一次阻塞
+    GLenum r = glClientWaitSync(fence, 0, 0);
+    if (r == GL_TIMEOUT_EXPIRED) {
+        auto start = std::chrono::steady_clock::now();
+        do {
+            r = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+        } while (r == GL_TIMEOUT_EXPIRED);
+        auto end = std::chrono::steady_clock::now();
+        sb->stalls++;
+        sb->stall_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    }
+    glDeleteSync(fence);
+    sb->fences[region] = nullptr;
+}
+
+static bool allocate_storage(StreamBuffer *sb) {
+    glBindBuffer(sb->target, sb->buffer);
+    glBufferData(sb->target, sb->region_size * sb->region_count, nullptr, GL_STREAM_DRAW);
+    return glGetError() == GL_NO_ERROR;
+}
+
+bool stream_buffer_init(StreamBuffer *sb, size_t region_size, size_t region_count, GLenum target) {
+    if (region_size == 0 || region_count == 0) return false;
+    sb->target = target;
+    sb->region_size = region_size;
+    sb->region_count = region_count;
+    sb->current = 0;
+    sb->mapped = false;
+    sb->fences.assign(region_count, nullptr);
+    glGenBuffers(1, &sb->buffer);
+    if (!allocate_storage(sb)) {
+        stream_buffer_destroy(sb);
+        return false;
+    }
+    return true;
+}
+
+void stream_buffer_destroy(StreamBuffer *sb) {
+    for (GLsync &fence : sb->fences) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    if (sb->buffer) {
+        glBindBuffer(sb->target, sb->buffer);
+        if (sb->mapped) glUnmapBuffer(sb->target);
+        glBindBuffer(sb->target, 0);
+        glDeleteBuffers(1, &sb->buffer);
+        sb->buffer = 0;
+    }
+    sb->mapped = false;
+    sb->region_size = 0;
+    sb->region_count = 0;
+}
+
+void *stream_buffer_map(StreamBuffer *sb, size_t size, size_t *offset) {
+    if (!sb->buffer || sb->mapped) return nullptr;
+
+    if (size > sb->region_size) {
+        // 扩容：等待所有区域空闲后重新分配，按 2 倍增长避免频繁扩容
+        for (size_t i = 0; i < sb->region_count; ++i) wait_fence(sb, i);
+        size_t new_size = sb->region_size;
+        while (new_size < size) new_size *= 2;
+        sb->region_size = new_size;
+        sb->current = 0;
+        sb->reallocs++;
+        if (!allocate_storage(sb)) return nullptr;
+    }
+
+    wait_fence(sb, sb->current);
+
+    size_t region_offset = sb->current * sb->region_size;
+    glBindBuffer(sb->target, sb->buffer);
+    void *ptr = glMapBufferRange(sb->target, region_offset, size,
+                                 GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+    if (!ptr) return nullptr;
+    sb->mapped = true;
+    sb->maps++;
+    *offset = region_offset;
+    return ptr;
+}
+
+void stream_buffer_unmap(StreamBuffer *sb) {
+    if (!sb->mapped) return;
+    glBindBuffer(sb->target, sb->buffer);
+    glUnmapBuffer(sb->target);
+    sb->mapped = false;
+}
+
+void stream_buffer_fence(StreamBuffer *sb) {
+    if (sb->fences[sb->current]) glDeleteSync(sb->fences[sb->current]);
+    sb->fences[sb->current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    sb->current = (sb->current + 1) % sb->region_count;
+}
@@ -0,0 +1,78 @@
+#include "thread-sched.hpp"
+
+#include <errno.h>
+#include <sched.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef SCHED_RESET_ON_FORK
+#define SCHED_RESET_ON_FORK 0x40000000
+#endif
+#ifndef MCL_ONFAULT
+#define MCL_ONFAULT 4
+#endif
+
+pid_t thread_sched_tid() {
+    return (pid_t)syscall(SYS_gettid);
+}
+
+int thread_sched_apply(const ThreadSched *sched) {
+    int applied = 0;
+    bool want_rt = sched->policy == SCHED_FIFO || sched->policy == SCHED_RR;
+    // pid 0 is the calling thread for both sched_setscheduler and setpriority
+    if (want_rt) {
+        struct sched_param param = {};
+        param.sched_priority = sched->priority;
+        if (sched_setscheduler(0, sched->policy | SCHED_RESET_ON_FORK, &param) == 0) {
+            applied |= THREAD_SCHED_APPLIED_RT;
+        }
+    }
+    if (!(applied & THREAD_SCHED_APPLIED_RT) && sched->nice != 0) {
+        // reset-on-fork also drops a negative nice in children
+        struct sched_param param = {};
+        sched_setscheduler(0, SCHED_OTHER | SCHED_RESET_ON_FORK, &param);
+        if (setpriority(PRIO_PROCESS, 0, sched->nice) == 0) {
+            applied |= THREAD_SCHED_APPLIED_NICE;
+        }
+    }
+    if (sched->cpu_mask) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu = 0; cpu < 64; ++cpu) {
+            if (sched->cpu_mask & (1ull << cpu)) CPU_SET(cpu, &set);
+        }
+        if (sched_setaffinity(0, sizeof(set), &set) == 0) {
+            applied |= THREAD_SCHED_APPLIED_AFFINITY;
+        }
+    }
+    return applied;
+}
+
+bool thread_sched_stats(pid_t tid, ThreadSchedStats *out) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/task/%d/schedstat", (int)tid);
+    FILE *f = fopen(path, "re");
+    if (!f) return false;
+    unsigned long long run = 0, wait = 0, slices = 0;
+    int n = fscanf(f, "%llu %llu %llu", &run, &wait, &slices);
+    fclose(f);
+    if (n != 3) return false;
+    out->run_ns = run;
+    out->wait_ns = wait;
+    out->slices = slices;
+    return true;
+}
+
+uint64_t thread_sched_wait_per_slice(const ThreadSchedStats *before, const ThreadSchedStats *after) {
+    if (after->slices <= before->slices) return 0;
+    return (after->wait_ns - before->wait_ns) / (after->slices - before->slices);
+}
+
+bool thread_sched_lock_memory() {
+    if (mlockall(MCL_CURRENT | MCL_FUTURE | MCL_ONFAULT) == 0) return true;
+    // kernels before 4.4 reject MCL_ONFAULT
+    return errno == EINVAL && mlockall(MCL_CURRENT | MCL_FUTURE) == 0;
+}
@@ -0,0 +1,248 @@
+#include "uring-reader.hpp"
+
+#ifdef CAVA_HAVE_IO_URING
+
+#include <cstring>
+#include <errno.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+
+static const uint64_t cancel_tag = UINT64_MAX;
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, const void *arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static inline unsigned load_acquire(const unsigned *p) {
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static inline void store_release(unsigned *p, unsigned v) {
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+// next free SQE, zeroed; nullptr if the submission queue is full
+static struct io_uring_sqe *get_sqe(UringReader *ur) {
+    unsigned tail = *ur->sq_tail;
+    if (tail - load_acquire(ur->sq_head) >= ur->sq_entries) return nullptr;
+    unsigned idx = tail & *ur->sq_mask;
+    struct io_uring_sqe *sqe = static_cast<struct io_uring_sqe *>(ur->sqes) + idx;
+    memset(sqe, 0, sizeof(*sqe));
+    ur->sq_array[idx] = idx;
+    return sqe;
+}
+
+// publish the SQE obtained from get_sqe
+static void commit_sqe(UringReader *ur) {
+    store_release(ur->sq_tail, *ur->sq_tail + 1);
+}
+
+static bool track(UringReader *ur, uint64_t tag) {
+    if (ur->inflight >= UringReader::max_inflight) return false;
+    ur->inflight_tags[ur->inflight++] = tag;
+    return true;
+}
+
+static void untrack(UringReader *ur, uint64_t tag) {
+    for (unsigned i = 0; i < ur->inflight; ++i) {
+        if (ur->inflight_tags[i] == tag) {
+            ur->inflight_tags[i] = ur->inflight_tags[--ur->inflight];
+            return;
+        }
+    }
+}
+
+bool uring_reader_init(UringReader *ur, unsigned entries) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    int fd = sys_io_uring_setup(entries, &p);
+    if (fd < 0) return false;
+    ur->ring_fd = fd;
+    ur->sq_entries = p.sq_entries;
+
+    ur->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    ur->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_mmap = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap && ur->cq_ring_size > ur->sq_ring_size) ur->sq_ring_size = ur->cq_ring_size;
+
+    ur->sq_ring = mmap(nullptr, ur->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       fd, IORING_OFF_SQ_RING);
+    if (ur->sq_ring == MAP_FAILED) {
+        ur->sq_ring = nullptr;
+        uring_reader_destroy(ur);
+        return false;
+    }
+    if (single_mmap) {
+        ur->cq_ring = ur->sq_ring;
+    } else {
+        ur->cq_ring = mmap(nullptr, ur->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                           fd, IORING_OFF_CQ_RING);
+        if (ur->cq_ring == MAP_FAILED) {
+            ur->cq_ring = nullptr;
+            uring_reader_destroy(ur);
+            return false;
+        }
+    }
+    ur->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    ur->sqes = mmap(nullptr, ur->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    fd, IORING_OFF_SQES);
+    if (ur->sqes == MAP_FAILED) {
+        ur->sqes = nullptr;
+        uring_reader_destroy(ur);
+        return false;
+    }
+
+    uint8_t *sq = static_cast<uint8_t *>(ur->sq_ring);
+    uint8_t *cq = static_cast<uint8_t *>(ur->cq_ring);
+    ur->sq_head = reinterpret_cast<unsigned *>(sq + p.sq_off.head);
+    ur->sq_tail = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+    ur->sq_mask = reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+    ur->sq_array = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+    ur->cq_head = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+    ur->cq_tail = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+    ur->cq_mask = reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+    ur->cqes = cq + p.cq_off.cqes;
+    ur->inflight = 0;
+    return true;
+}
+
+void uring_reader_destroy(UringReader *ur) {
+    if (ur->ring_fd >= 0) {
+        uring_reader_cancel_all(ur);
+        if (ur->buffer) sys_io_uring_register(ur->ring_fd, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+    }
+    if (ur->sqes) munmap(ur->sqes, ur->sqes_size);
+    if (ur->cq_ring && ur->cq_ring != ur->sq_ring) munmap(ur->cq_ring, ur->cq_ring_size);
+    if (ur->sq_ring) munmap(ur->sq_ring, ur->sq_ring_size);
+    if (ur->ring_fd >= 0) close(ur->ring_fd);
+    *ur = UringReader();
+}
+
+bool uring_reader_register_buffer(UringReader *ur, uint8_t *base, size_t size) {
+    if (ur->buffer) {
+        sys_io_uring_register(ur->ring_fd, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+        ur->buffer = nullptr;
+        ur->buffer_size = 0;
+    }
+    struct iovec iov = { base, size };
+    if (sys_io_uring_register(ur->ring_fd, IORING_REGISTER_BUFFERS, &iov, 1) < 0) return false;
+    ur->buffer = base;
+    ur->buffer_size = size;
+    return true;
+}
+
+bool uring_reader_queue_read(UringReader *ur, int fd, size_t offset, size_t len, uint64_t tag) {
+    if (!ur->buffer || offset + len > ur->buffer_size || tag == cancel_tag) return false;
+    struct io_uring_sqe *sqe = get_sqe(ur);
+    if (!sqe || !track(ur, tag)) return false;
+    sqe->opcode = IORING_OP_READ_FIXED;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(ur->buffer + offset);
+    sqe->len = static_cast<uint32_t>(len);
+    sqe->off = static_cast<uint64_t>(-1); // pipes/FIFOs: current position
+    sqe->buf_index = 0;
+    sqe->user_data = tag;
+    commit_sqe(ur);
+    return true;
+}
+
+bool uring_reader_queue_poll(UringReader *ur, int fd, uint64_t tag) {
+    if (tag == cancel_tag) return false;
+    struct io_uring_sqe *sqe = get_sqe(ur);
+    if (!sqe || !track(ur, tag)) return false;
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = tag;
+    commit_sqe(ur);
+    return true;
+}
+
+// copy up to max CQEs out of the completion ring
+static int reap(UringReader *ur, UringCompletion *out, int max) {
+    unsigned head = *ur->cq_head;
+    unsigned tail = load_acquire(ur->cq_tail);
+    int n = 0;
+    while (head != tail && n < max) {
+        const struct io_uring_cqe *cqe = static_cast<const struct io_uring_cqe *>(ur->cqes) + (head & *ur->cq_mask);
+        head++;
+        if (cqe->user_data == cancel_tag) continue;
+        untrack(ur, cqe->user_data);
+        out[n].tag = cqe->user_data;
+        out[n].res = cqe->res;
+        n++;
+    }
+    store_release(ur->cq_head, head);
+    ur->completions += (uint64_t)n;
+    return n;
+}
+
+int uring_reader_wait(UringReader *ur, UringCompletion *out, int max) {
+    for (;;) {
+        int n = reap(ur, out, max);
+        if (n > 0) return n;
+        // one syscall submits whatever is queued and sleeps until a completion arrives
+        unsigned to_submit = *ur->sq_tail - load_acquire(ur->sq_head);
+        ur->enters++;
+        int r = sys_io_uring_enter(ur->ring_fd, to_submit, 1, IORING_ENTER_GETEVENTS);
+        if (r < 0 && errno != EINTR) return -1;
+    }
+}
+
+void uring_reader_cancel_all(UringReader *ur) {
+    for (unsigned i = 0; i < ur->inflight; ++i) {
+        struct io_uring_sqe *sqe = get_sqe(ur);
+        if (!sqe) break;
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = ur->inflight_tags[i];
+        sqe->user_data = cancel_tag;
+        commit_sqe(ur);
+    }
+    // cancelled requests still post a CQE (-ECANCELED); wait for all of them
+    UringCompletion drained[UringReader::max_inflight];
+    while (ur->inflight > 0) {
+        if (uring_reader_wait(ur, drained, UringReader::max_inflight) < 0) break;
+    }
+}
+
+#else
+
+bool uring_reader_init(UringReader *, unsigned) {
+    return false;
+}
+
+void uring_reader_destroy(UringReader *) {
+}
+
+bool uring_reader_register_buffer(UringReader *, uint8_t *, size_t) {
+    return false;
+}
+
+bool uring_reader_queue_read(UringReader *, int, size_t, size_t, uint64_t) {
+    return false;
+}
+
+bool uring_reader_queue_poll(UringReader *, int, uint64_t) {
+    return false;
+}
+
+int uring_reader_wait(UringReader *, UringCompletion *, int) {
+    return -1;
+}
+
+void uring_reader_cancel_all(UringReader *) {
+}
+
+#endif
@@ -0,0 +1,230 @@
+// 广播模式被套圈时的游标计数：容量 8 的环，不限速的 fake-cava 输出 50000 帧后退出（不重启）。
+// 三个游标各在一个线程里读取：一个尽快读，一个每帧后睡眠 1 ms（必然被生产者套圈），
+// 一个每次先 seek_latest 再读。对每个游标检查：
+// - 读到的帧 seq 严格递增，内容符合 fake-cava 的规律（第 n 帧第 i 个样本为 n + i），
+//   即被覆盖中途的撕裂复制从未被当作有效帧返回；
+// - 读到的帧数 + cava_cursor_missed == 打开游标之后发布的帧数，被套圈的帧一帧不差地计入 missed。
+// 单核上生产者几乎不会恰好在复制途中改写同一槽位，因此另有一段确定性的检查：暂停 cava，
+// 经可写映射把游标下一帧所在槽位的 seq 改为奇数（模拟生产者正在写），该帧必须被跳过并计入 missed。
+#include <atomic>
+#include <stdint.h>
+#include <stdio.h>
+#include <thread>
+#include <time.h>
+#include <vector>
+#include <sys/mman.h>
+
+#include "bench-util.hpp"
+#include "cava-input.hpp"
+
+static const size_t bars = 256;
+static const long total_frames = 50000;
+
+enum Pace { PACE_FAST, PACE_SLOW, PACE_SEEK };
+
+struct CursorRun {
+    const char *name;
+    Pace pace;
+    cava_cursor *cursor = nullptr;
+    uint64_t start = 0;     // 打开时已发布的帧数
+    uint64_t read = 0;
+    int errors = 0;
+};
+
+static uint64_t published(cava_stream *stream) {
+    struct cava_reader_stats stats;
+    cava_stream_stats(stream, &stats);
+    return stats.frames_published;
+}
+
+// 打开游标并确定它从哪一帧开始：打开前后发布计数相同时，start 即为该计数
+static cava_cursor *open_cursor_at(cava_stream *stream, uint64_t *start) {
+    for (;;) {
+        uint64_t before = published(stream);
+        cava_cursor *cursor = cava_stream_cursor_open(stream);
+        if (!cursor || published(stream) == before) {
+            *start = before;
+            return cursor;
+        }
+        cava_cursor_close(cursor);
+    }
+}
+
+static void run_cursor(cava_stream *stream, CursorRun *run) {
+    std::vector<uint16_t> frame(bars);
+    bool have_seq = false;
+    uint64_t last_seq = 0;
+    for (;;) {
+        if (run->pace == PACE_SEEK) cava_cursor_seek_latest(run->cursor);
+        cava_frame_info info;
+        int r = cava_cursor_read_raw(run->cursor, frame.data(), frame.size() * sizeof(uint16_t), &info);
+        if (r < 0) {
+            run->errors++;
+            return;
+        }
+        if (r == 0) {
+            // 先看是否已停止，再做最后一次读取，避免漏掉停止前发布的帧
+            if (!cava_stream_running(stream)) {
+                if (cava_cursor_read_raw(run->cursor, frame.data(), frame.size() * sizeof(uint16_t), &info) != 1) {
+                    return;
+                }
+            } else {
+                cava_cursor_wait(run->cursor, 10000000);
+                continue;
+            }
+        }
+        run->read++;
+        if (have_seq && info.seq <= last_seq) {
+            if (run->errors++ < 5) fprintf(stderr, "%s: seq %llu after %llu\n", run->name,
+                                           (unsigned long long)info.seq, (unsigned long long)last_seq);
+        }
+        have_seq = true;
+        last_seq = info.seq;
+        for (size_t i = 0; i < bars; i++) {
+            if (frame[i] != (uint16_t)(info.seq + i)) {
+                if (run->errors++ < 5) fprintf(stderr, "%s: torn frame %llu at sample %zu\n", run->name,
+                                               (unsigned long long)info.seq, i);
+                break;
+            }
+        }
+        if (run->pace == PACE_SLOW) {
+            struct timespec ts = { 0, 1000000 };
+            nanosleep(&ts, nullptr);
+        }
+    }
+}
+
+static void sleep_ms(long ms) {
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    nanosleep(&ts, nullptr);
+}
+
+// 暂停的 stream 上，游标停在倒数第二帧，该槽位的 seq 为奇数：read 应跳过它（missed + 1）并返回最后一帧
+static int check_torn_slot() {
+    fake_cava_use(200);
+    cava_reader_options opts;
+    cava_reader_options_init(&opts);
+    opts.bars_number = bars;
+    opts.ring_mode = CAVA_RING_BROADCAST;
+    opts.ring_capacity = 8;
+    opts.sample_format = CAVA_SAMPLE_RAW;
+    cava_stream *stream = cava_stream_start(&opts);
+    if (!stream) {
+        fprintf(stderr, "cava_stream_start failed\n");
+        return 1;
+    }
+    uint64_t start = 0;
+    cava_cursor *cursor = open_cursor_at(stream, &start);
+    int fd = cava_stream_shm_fd(stream);
+    size_t size = cava_stream_shm_size(stream);
+    uint8_t *base = fd >= 0 ? (uint8_t *)mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                            : (uint8_t *)MAP_FAILED;
+    if (!cursor || base == MAP_FAILED) {
+        fprintf(stderr, "torn: cannot open cursor or map the ring\n");
+        if (cursor) cava_cursor_close(cursor);
+        cava_stream_stop(stream);
+        return 1;
+    }
+    cava_shm_header *hdr = (cava_shm_header *)base;
+    cava_shm_slot *slots = (cava_shm_slot *)(base + hdr->slots_offset);
+
+    // 等游标之后至少 4 帧，然后暂停，直到发布计数稳定（管道中剩余的帧已读出）
+    while (published(stream) < start + 4) sleep_ms(5);
+    cava_stream_pause(stream);
+    uint64_t end;
+    do {
+        end = published(stream);
+        sleep_ms(50);
+    } while (published(stream) != end);
+
+    std::vector<uint16_t> frame(bars);
+    cava_frame_info info;
+    uint64_t read = 0;
+    // 读到倒数第二帧之前（容量 8，更早的帧可能已被套圈，计入 missed）
+    while (start + read + cava_cursor_missed(cursor) < end - 2) {
+        if (cava_cursor_read_raw(cursor, frame.data(), frame.size() * sizeof(uint16_t), &info) != 1) break;
+        read++;
+    }
+    int failures = 0;
+    uint64_t missed_before = cava_cursor_missed(cursor);
+    if (start + read + missed_before != end - 2) {
+        fprintf(stderr, "torn: cursor is not at the second to last frame\n");
+        failures++;
+    }
+    cava_shm_slot *slot = &slots[(end - 2) % hdr->slot_count];
+    __atomic_fetch_add(&slot->seq, 1, __ATOMIC_SEQ_CST);
+    int r = cava_cursor_read_raw(cursor, frame.data(), frame.size() * sizeof(uint16_t), &info);
+    __atomic_fetch_add(&slot->seq, 1, __ATOMIC_SEQ_CST);
+    if (r != 1 || cava_cursor_missed(cursor) != missed_before + 1) {
+        fprintf(stderr, "torn: slot being written was not skipped (r=%d)\n", r);
+        failures++;
+    } else if (frame[0] != (uint16_t)info.seq ||
+               info.seq != __atomic_load_n(&slots[(end - 1) % hdr->slot_count].frame_seq, __ATOMIC_RELAXED)) {
+        fprintf(stderr, "torn: did not return the last frame\n");
+        failures++;
+    }
+    printf("torn slot skipped: missed %llu -> %llu\n", (unsigned long long)missed_before,
+           (unsigned long long)cava_cursor_missed(cursor));
+    munmap(base, size);
+    cava_cursor_close(cursor);
+    cava_stream_stop(stream);
+    return failures;
+}
+
+int main() {
+    if (check_torn_slot()) return 1;
+
+    fake_cava_use(0, total_frames);
+    cava_reader_options opts;
+    cava_reader_options_init(&opts);
+    opts.bars_number = bars;
+    opts.ring_mode = CAVA_RING_BROADCAST;
+    opts.ring_capacity = 8;
+    opts.sample_format = CAVA_SAMPLE_RAW;
+    opts.respawn = 0;
+    cava_stream *stream = cava_stream_start(&opts);
+    if (!stream) {
+        fprintf(stderr, "cava_stream_start failed\n");
+        return 1;
+    }
+
+    CursorRun runs[] = {
+        { "fast", PACE_FAST },
+        { "slow", PACE_SLOW },
+        { "seek-latest", PACE_SEEK },
+    };
+    for (CursorRun &run : runs) {
+        run.cursor = open_cursor_at(stream, &run.start);
+        if (!run.cursor) {
+            fprintf(stderr, "cursor_open failed\n");
+            return 1;
+        }
+    }
+
+    std::vector<std::thread> threads;
+    for (CursorRun &run : runs) threads.emplace_back(run_cursor, stream, &run);
+    for (std::thread &t : threads) t.join();
+    uint64_t end = published(stream);
+
+    int failures = 0;
+    for (CursorRun &run : runs) {
+        uint64_t missed = cava_cursor_missed(run.cursor);
+        cava_cursor_close(run.cursor);
+        printf("%-12s read %6llu missed %6llu of %llu\n", run.name, (unsigned long long)run.read,
+               (unsigned long long)missed, (unsigned long long)(end - run.start));
+        if (run.errors) {
+            fprintf(stderr, "%s: %d bad frames\n", run.name, run.errors);
+            failures++;
+        }
+        if (run.read + missed != end - run.start) {
+            fprintf(stderr, "%s: read + missed != published since open\n", run.name);
+            failures++;
+        }
+        if (run.pace == PACE_SLOW && (missed == 0 || run.read == 0)) {
+            fprintf(stderr, "%s: expected to be lapped and still read frames\n", run.name);
+            failures++;
+        }
+    }
+    cava_stream_stop(stream);
+    return failures ? 1 : 0;
+}
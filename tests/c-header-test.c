@@ -0,0 +1,90 @@
+// cava-input.hpp 作为 C 头文件使用：以 C11 编译，启动一个广播模式、原始样本的 stream（fake-cava），
+// 只读 mmap 它的共享环形缓冲，按头文件说明的 __atomic 规则与 seqlock 协议读取最新帧，
+// 并按 fake-cava 的样本规律（第 n 帧第 i 个样本为 n + i）校验内容。
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#include "cava-input.hpp"
+
+static const size_t bars = 64;
+
+static void sleep_ms(long ms) {
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+int main(void) {
+    char path[4096];
+    const char *old = getenv("PATH");
+    snprintf(path, sizeof path, "%s:%s", FAKE_CAVA_DIR, old ? old : "");
+    setenv("PATH", path, 1);
+    setenv("FAKE_CAVA_FPS", "500", 1);
+    unsetenv("FAKE_CAVA_FRAMES");
+
+    struct cava_reader_options opts;
+    cava_reader_options_init(&opts);
+    opts.bars_number = bars;
+    opts.ring_mode = CAVA_RING_BROADCAST;
+    opts.sample_format = CAVA_SAMPLE_RAW;
+    cava_stream *stream = cava_stream_start(&opts);
+    if (!stream) {
+        fprintf(stderr, "cava_stream_start failed\n");
+        return 1;
+    }
+    int fd = cava_stream_shm_fd(stream);
+    size_t size = cava_stream_shm_size(stream);
+    const uint8_t *base = fd >= 0 ? mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "cannot map the shared ring\n");
+        cava_stream_stop(stream);
+        return 1;
+    }
+    const struct cava_shm_header *hdr = (const struct cava_shm_header *)base;
+    const struct cava_shm_slot *slots = (const struct cava_shm_slot *)(base + hdr->slots_offset);
+    const uint8_t *data = base + hdr->data_offset;
+    int ok = hdr->magic == CAVA_SHM_MAGIC && hdr->version == CAVA_SHM_VERSION && hdr->bars == bars &&
+             hdr->sample_bytes == 2 && hdr->sample_format == CAVA_SAMPLE_RAW;
+    if (!ok) fprintf(stderr, "unexpected header\n");
+
+    uint16_t frame[64];
+    int checked = 0;
+    for (int attempt = 0; ok && checked < 20 && attempt < 2000; attempt++) {
+        uint64_t published = __atomic_load_n(&hdr->published, __ATOMIC_ACQUIRE);
+        if (published == 0) {
+            sleep_ms(2);
+            continue;
+        }
+        uint64_t index = published - 1;
+        size_t slot = (size_t)(index % hdr->slot_count);
+        uint64_t seq = __atomic_load_n(&slots[slot].seq, __ATOMIC_ACQUIRE);
+        uint64_t slot_index = __atomic_load_n(&slots[slot].index, __ATOMIC_RELAXED);
+        uint64_t frame_seq = __atomic_load_n(&slots[slot].frame_seq, __ATOMIC_RELAXED);
+        memcpy(frame, data + slot * bars * 2, bars * 2);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if ((seq & 1) || __atomic_load_n(&slots[slot].seq, __ATOMIC_RELAXED) != seq || slot_index != index) {
+            continue;   // 复制期间被覆盖，重试
+        }
+        for (size_t i = 0; i < bars; i++) {
+            if (frame[i] != (uint16_t)(frame_seq + i)) {
+                fprintf(stderr, "frame %llu sample %zu is %u\n", (unsigned long long)frame_seq, i, frame[i]);
+                ok = 0;
+                break;
+            }
+        }
+        checked++;
+        sleep_ms(3);
+    }
+    munmap((void *)base, size);
+    cava_stream_stop(stream);
+    if (ok && checked < 20) {
+        fprintf(stderr, "only %d frames read\n", checked);
+        ok = 0;
+    }
+    if (!ok) return 1;
+    printf("%d frames read from C through the shared ring\n", checked);
+    return 0;
+}
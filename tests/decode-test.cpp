@@ -0,0 +1,93 @@
+// 每个可用的 SIMD 解码内核（cava_decoder_get 返回非空的级别）与标量实现逐位比较：
+// u16/u8 及其逆序版本，长度 0..2049（覆盖各向量宽度的尾部），src/dst 错开对齐，
+// 并检查 dst 末尾之后没有被写。
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "cava-decode.hpp"
+
+static const size_t max_count = 2049;
+static const size_t src_offsets[] = { 0, 1, 3 };   // 字节
+static const size_t dst_offsets[] = { 0, 1, 3 };   // float
+static const size_t guard = 16;                    // dst 之后检查的 float 数
+
+struct Kernel {
+    const char *name;
+    size_t sample_bytes;
+    float scale;
+    cava_decode_fn cava_decoder::*fn;
+};
+
+static const Kernel kernels[] = {
+    { "u16", 2, 1.0f / 65535.0f, &cava_decoder::u16 },
+    { "u8", 1, 1.0f / 255.0f, &cava_decoder::u8 },
+    { "u16_rev", 2, 1.0f / 65535.0f, &cava_decoder::u16_rev },
+    { "u8_rev", 1, 1.0f / 255.0f, &cava_decoder::u8_rev },
+};
+
+int main() {
+    const cava_decoder *scalar = cava_decoder_get(CAVA_SIMD_SCALAR);
+    if (!scalar) {
+        fprintf(stderr, "no scalar decoder\n");
+        return 1;
+    }
+
+    // 固定种子的随机样本，开头放上 0 与最大值
+    std::vector<uint8_t> input(max_count * 2 + 8);
+    srand(12345);
+    for (uint8_t &b : input) b = (uint8_t)(rand() & 0xff);
+    input[0] = input[1] = 0x00;
+    input[2] = input[3] = 0xff;
+
+    std::vector<float> expected(max_count + guard);
+    std::vector<float> actual(max_count + guard + 4);
+    const float canary = -12345.0f;
+    int failures = 0;
+    int tested_levels = 0;
+
+    for (int level = CAVA_SIMD_SCALAR; level <= CAVA_SIMD_NEON; level++) {
+        const cava_decoder *decoder = cava_decoder_get(level);
+        if (!decoder) continue;
+        tested_levels++;
+        for (const Kernel &k : kernels) {
+            cava_decode_fn fn = decoder->*(k.fn);
+            cava_decode_fn ref = scalar->*(k.fn);
+            for (size_t src_off : src_offsets) {
+                const uint8_t *src = input.data() + src_off;
+                for (size_t count = 0; count <= max_count; count++) {
+                    ref(src, expected.data(), count, k.scale);
+                    for (size_t dst_off : dst_offsets) {
+                        float *dst = actual.data() + dst_off;
+                        for (size_t i = 0; i < count + guard; i++) dst[i] = canary;
+                        fn(src, dst, count, k.scale);
+                        if (memcmp(dst, expected.data(), count * sizeof(float)) != 0) {
+                            if (failures++ < 20) {
+                                fprintf(stderr, "%s %s: mismatch at count %zu src+%zu dst+%zu\n", decoder->name,
+                                        k.name, count, src_off, dst_off);
+                            }
+                        }
+                        for (size_t i = count; i < count + guard; i++) {
+                            if (dst[i] != canary) {
+                                if (failures++ < 20) {
+                                    fprintf(stderr, "%s %s: wrote past the end at count %zu src+%zu dst+%zu\n",
+                                            decoder->name, k.name, count, src_off, dst_off);
+                                }
+                                break;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        printf("%s: checked\n", decoder->name);
+    }
+
+    if (failures) {
+        fprintf(stderr, "%d failures\n", failures);
+        return 1;
+    }
+    printf("%d decoder levels bit-exact against scalar\n", tested_levels);
+    return 0;
+}
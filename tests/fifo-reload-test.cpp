@@ -0,0 +1,99 @@
+// 经 FIFO（opts.fifo_path）传输时运行中修改帧率：cava 收到 SIGUSR1 后关闭并重新打开 raw_target，
+// 期间 FIFO 上暂时没有写端。读取端不能把这当作 cava 退出，restarts 必须保持 0，
+// 两次 set_framerate 都应以 SIGUSR1 重新加载完成，之后帧继续到达。read()、io_uring 与无线程模式各测一次。
+// 读取端一直持有 FIFO 的写端，cava 真正退出只能经 pidfd 发现：另测一个写完 50 帧就退出的 cava 会被重启。
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "bench-util.hpp"
+#include "cava-input.hpp"
+
+// 取 count 帧，每帧最多等 1 秒
+static bool pop_frames(cava_stream *stream, std::vector<float> &frame, int count) {
+    for (int i = 0; i < count; i++) {
+        if (cava_stream_wait_pop(stream, frame.data(), frame.size(), 1000000000) != 1) return false;
+    }
+    return true;
+}
+
+static bool run(const char *name, int backend, int threadless, const std::string &fifo) {
+    cava_reader_options opts;
+    cava_reader_options_init(&opts);
+    opts.bars_number = 32;
+    opts.fifo_path = fifo.c_str();
+    opts.framerate = 200;
+    opts.backend = backend;
+    opts.threadless = threadless;
+    cava_stream *stream = cava_stream_start(&opts);
+    if (!stream) {
+        fprintf(stderr, "%s: cava_stream_start failed\n", name);
+        return false;
+    }
+    std::vector<float> frame(32);
+    bool ok = pop_frames(stream, frame, 20);
+    if (ok && cava_stream_set_framerate(stream, 300) != CAVA_OK) ok = false;
+    if (ok) ok = pop_frames(stream, frame, 60);
+    if (ok && cava_stream_set_framerate(stream, 250) != CAVA_OK) ok = false;
+    if (ok) ok = pop_frames(stream, frame, 60);
+    if (!ok) fprintf(stderr, "%s: frames stopped arriving\n", name);
+
+    struct cava_reader_stats stats;
+    cava_stream_stats(stream, &stats);
+    cava_stream_stop(stream);
+    printf("%-10s restarts %llu reloads %llu framerate %llu\n", name, (unsigned long long)stats.restarts,
+           (unsigned long long)stats.reloads, (unsigned long long)stats.framerate);
+    if (stats.restarts != 0) {
+        fprintf(stderr, "%s: framerate change over the FIFO restarted cava\n", name);
+        ok = false;
+    }
+    if (stats.reloads != 2 || stats.framerate != 250) {
+        fprintf(stderr, "%s: expected two reloads ending at 250 fps\n", name);
+        ok = false;
+    }
+    return ok;
+}
+
+static bool run_exit(const std::string &fifo) {
+    fake_cava_use(-1, 50);
+    cava_reader_options opts;
+    cava_reader_options_init(&opts);
+    opts.bars_number = 32;
+    opts.fifo_path = fifo.c_str();
+    opts.framerate = 500;
+    opts.restart_delay_ms = 10;
+    cava_stream *stream = cava_stream_start(&opts);
+    if (!stream) {
+        fprintf(stderr, "exit: cava_stream_start failed\n");
+        return false;
+    }
+    std::vector<float> frame(32);
+    // 两个 cava 的量：第一个退出后必须被重启，否则帧在第 50 帧后停止
+    bool ok = pop_frames(stream, frame, 80);
+    uint64_t restarts = cava_stream_restarts(stream);
+    cava_stream_stop(stream);
+    printf("%-10s restarts %llu\n", "exit", (unsigned long long)restarts);
+    if (!ok || restarts == 0) {
+        fprintf(stderr, "exit: cava exiting over the FIFO was not noticed\n");
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    // 帧率来自配置（不设置 FAKE_CAVA_FPS），重新加载才会真正改变 fake-cava 的节奏
+    fake_cava_use(-1);
+    char dir[] = "/tmp/cava-fifo-XXXXXX";
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    std::string fifo = std::string(dir) + "/raw";
+    bool ok = run("read", CAVA_BACKEND_READ, 0, fifo) && run("io_uring", CAVA_BACKEND_IO_URING, 0, fifo) &&
+              run("threadless", CAVA_BACKEND_READ, 1, fifo) && run_exit(fifo);
+    unlink(fifo.c_str());
+    rmdir(dir);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,269 @@
+// 多实例压力测试：默认实例与若干 cava_stream 同时运行（fake-cava，约 500 fps，每 400 帧退出一次
+// 以触发重启），覆盖队列/邮箱/广播模式、有线程与无线程、单声道与立体声、16bit 与 8bit。
+// 每个消费者在自己的线程里取帧，检查帧序号递增、帧内样本符合 fake-cava 的规律；
+// 同时一个控制线程在所有实例上读取 stats、暂停/恢复、修改帧率，另一个线程反复启动、停止短命的 stream。
+// 以 -fsanitize=thread 构建时（CAVALAYER_TSAN）也检查数据竞争；广播游标的 seqlock 复制
+// 按设计会与生产者并发读写同一槽位（读完再校验 seq），TSAN 会误报，因此该变体不运行广播模式。
+// 用法: reader-stress [秒数，默认 3]
+#include <atomic>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <time.h>
+#include <vector>
+
+#include "bench-util.hpp"
+#include "cava-input.hpp"
+
+#if defined(__SANITIZE_THREAD__)
+#define STRESS_TSAN 1
+#elif defined(__has_feature)
+#if __has_feature(thread_sanitizer)
+#define STRESS_TSAN 1
+#endif
+#endif
+
+static std::atomic<bool> stop_flag{false};
+static std::atomic<int> failures{0};
+
+static void fail(const char *name, const char *what) {
+    if (failures.fetch_add(1) < 20) fprintf(stderr, "%s: %s\n", name, what);
+}
+
+static void sleep_ms(long ms) {
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    nanosleep(&ts, nullptr);
+}
+
+// fake-cava 第 n 帧第 i 个原始样本为 n + i（截断到样本宽度）；立体声左声道 lane 被翻转为低频在前。
+// 重启后 n 从 0 重新开始，因此只检查帧内的相对关系
+static bool frame_consistent(const float *frame, size_t bars, size_t channels, unsigned max_value) {
+    auto raw = [&](size_t k) { return (unsigned)lrintf(frame[k] * (float)max_value); };
+    // 原始顺序中第 0 个样本的位置：单声道为 0，立体声为左 lane 的末尾
+    unsigned base = channels == 2 ? raw(bars - 1) : raw(0);
+    for (size_t k = 0; k < bars * channels; k++) {
+        size_t raw_index = k;
+        if (channels == 2) raw_index = k < bars ? bars - 1 - k : k;
+        if (raw(k) != ((base + raw_index) & max_value)) return false;
+    }
+    return true;
+}
+
+struct Checker {
+    const char *name;
+    size_t bars;
+    size_t channels;
+    unsigned max_value;
+    uint64_t last_seq = 0;
+    bool have_seq = false;
+    uint64_t frames = 0;
+
+    void check(const float *frame, const cava_frame_info *info) {
+        frames++;
+        if (!frame_consistent(frame, bars, channels, max_value)) fail(name, "frame content mismatch");
+        if (!info) return;
+        if (have_seq && info->seq <= last_seq) fail(name, "frame sequence went backwards");
+        last_seq = info->seq;
+        have_seq = true;
+    }
+};
+
+static cava_reader_options make_options(int mode, size_t bars, int channels, const char *bit_format, int threadless) {
+    cava_reader_options opts;
+    cava_reader_options_init(&opts);
+    opts.ring_mode = mode;
+    opts.bars_number = bars;
+    opts.channels = channels;
+    opts.bit_format = bit_format;
+    opts.threadless = threadless;
+    opts.ring_capacity = 8;
+    opts.restart_delay_ms = 20;
+    opts.restart_delay_max_ms = 50;
+    return opts;
+}
+
+// 队列模式：交替使用 wait_pop 与 try_pop_n（无线程模式下 wait_pop 自行 service）
+static void consume_queue(cava_stream *stream, Checker *checker) {
+    size_t frame_len = checker->bars * checker->channels;
+    std::vector<float> frames(frame_len * 4);
+    cava_frame_info infos[4];
+    bool threadless = checker->name[0] == 't';
+    while (!stop_flag.load()) {
+        if (threadless || checker->frames % 2 == 0) {
+            if (cava_stream_wait_pop(stream, frames.data(), frame_len, 50000000) == 1) {
+                checker->check(frames.data(), nullptr);
+            }
+            continue;
+        }
+        int n = cava_stream_try_pop_n(stream, frames.data(), frames.size(), infos);
+        if (n < 0) fail(checker->name, "try_pop_n failed");
+        for (int k = 0; k < n; k++) checker->check(frames.data() + k * frame_len, &infos[k]);
+        if (n == 0) sleep_ms(1);
+    }
+}
+
+// 邮箱模式：零拷贝 peek，持有视图一小会儿再释放
+static void consume_latest(cava_stream *stream, Checker *checker) {
+    while (!stop_flag.load()) {
+        const float *frame;
+        cava_frame_info info;
+        int r = cava_stream_peek(stream, &frame, &info);
+        if (r < 0) fail(checker->name, "peek failed");
+        if (r == 1) {
+            checker->check(frame, &info);
+            sleep_ms(1);
+            cava_stream_release(stream);
+        } else {
+            sleep_ms(1);
+        }
+    }
+}
+
+// 广播模式：一个游标阻塞等待，逐帧读取
+static void consume_cursor(cava_stream *stream, Checker *checker) {
+    cava_cursor *cursor = cava_stream_cursor_open(stream);
+    if (!cursor) {
+        fail(checker->name, "cursor_open failed");
+        return;
+    }
+    std::vector<float> frame(checker->bars * checker->channels);
+    while (!stop_flag.load()) {
+        if (cava_cursor_wait(cursor, 50000000) != 1) continue;
+        cava_frame_info info;
+        while (cava_cursor_read(cursor, frame.data(), frame.size(), &info) == 1) checker->check(frame.data(), &info);
+    }
+    cava_cursor_close(cursor);
+}
+
+// 默认实例（cava_reader_*）：队列模式，peek 与 try_pop_ex 交替
+static void consume_default(Checker *checker) {
+    std::vector<float> frame(checker->bars * checker->channels);
+    while (!stop_flag.load()) {
+        const float *view;
+        cava_frame_info info;
+        int r;
+        if (checker->frames % 2 == 0) {
+            r = cava_reader_peek_ex(&view, &info);
+            if (r == 1) checker->check(view, &info);
+        } else {
+            r = cava_reader_try_pop_ex(frame.data(), frame.size(), &info);
+            if (r == 1) checker->check(frame.data(), &info);
+        }
+        if (r < 0) fail(checker->name, "default instance read failed");
+        if (r == 0) sleep_ms(1);
+    }
+    cava_reader_release();
+}
+
+int main(int argc, char **argv) {
+    double seconds = argc > 1 ? atof(argv[1]) : 3.0;
+    // 所有 cava 都在同一环境下启动；每 400 帧退出一次，读取端自动重启它
+    fake_cava_use(500, 400);
+
+    cava_reader_options def = make_options(CAVA_RING_QUEUE, 48, 1, "16bit", 0);
+    if (cava_reader_start_ex(&def) != CAVA_OK) {
+        fprintf(stderr, "cava_reader_start_ex failed\n");
+        return 1;
+    }
+
+    struct Spec {
+        const char *name;   // 以 t 开头的是无线程模式
+        int mode;
+        size_t bars;
+        int channels;
+        const char *bit_format;
+        int threadless;
+    };
+    std::vector<Spec> specs = {
+        { "queue", CAVA_RING_QUEUE, 64, 1, "16bit", 0 },
+        { "queue-8bit", CAVA_RING_QUEUE, 100, 1, "8bit", 0 },
+        { "latest-stereo", CAVA_RING_LATEST, 32, 2, "16bit", 0 },
+        { "threadless-queue", CAVA_RING_QUEUE, 128, 1, "16bit", 1 },
+        { "threadless-stereo", CAVA_RING_QUEUE, 20, 2, "8bit", 1 },
+#ifndef STRESS_TSAN
+        { "broadcast", CAVA_RING_BROADCAST, 256, 1, "16bit", 0 },
+#endif
+    };
+
+    std::vector<cava_stream *> streams;
+    std::vector<Checker> checkers;
+    checkers.reserve(specs.size() + 1);
+    for (const Spec &spec : specs) {
+        cava_reader_options opts = make_options(spec.mode, spec.bars, spec.channels, spec.bit_format, spec.threadless);
+        cava_stream *stream = cava_stream_start(&opts);
+        if (!stream) {
+            fprintf(stderr, "%s: cava_stream_start failed\n", spec.name);
+            return 1;
+        }
+        streams.push_back(stream);
+        unsigned max_value = spec.bit_format[0] == '8' ? 255 : 65535;
+        checkers.push_back({ spec.name, spec.bars, (size_t)spec.channels, max_value });
+    }
+    checkers.push_back({ "default", 48, 1, 65535 });
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < specs.size(); i++) {
+        cava_stream *stream = streams[i];
+        Checker *checker = &checkers[i];
+        switch (specs[i].mode) {
+        case CAVA_RING_QUEUE: threads.emplace_back(consume_queue, stream, checker); break;
+        case CAVA_RING_LATEST: threads.emplace_back(consume_latest, stream, checker); break;
+        default: threads.emplace_back(consume_cursor, stream, checker); break;
+        }
+    }
+    threads.emplace_back(consume_default, &checkers.back());
+
+    // 控制线程：stats、暂停/恢复、帧率在 400/500 之间切换，均可在任意线程调用
+    threads.emplace_back([&] {
+        for (unsigned tick = 0; !stop_flag.load(); tick++) {
+            struct cava_reader_stats stats;
+            for (cava_stream *stream : streams) {
+                if (cava_stream_stats(stream, &stats) != CAVA_OK) fail("control", "stats failed");
+            }
+            if (cava_reader_stats(&stats) != CAVA_OK) fail("control", "default stats failed");
+            cava_stream *target = streams[tick % streams.size()];
+            if (tick % 4 == 1) cava_stream_pause(target);
+            if (tick % 4 == 2) cava_stream_resume(streams[(tick - 1) % streams.size()]);
+            if (tick % 8 == 3) cava_stream_set_framerate(streams[0], tick % 16 == 3 ? 400 : 500);
+            if (tick % 8 == 5) cava_reader_set_framerate(tick % 16 == 5 ? 400 : 500);
+            sleep_ms(30);
+        }
+    });
+
+    // 启停线程：与其他实例并发地反复创建、读取并销毁 stream
+    std::atomic<int> churned{0};
+    threads.emplace_back([&] {
+        while (!stop_flag.load()) {
+            cava_reader_options opts = make_options(CAVA_RING_QUEUE, 16, 1, "16bit", churned % 2);
+            cava_stream *stream = cava_stream_start(&opts);
+            if (!stream) {
+                fail("churn", "cava_stream_start failed");
+                return;
+            }
+            float frame[16];
+            cava_stream_wait_pop(stream, frame, 16, 100000000);
+            cava_stream_stop(stream);
+            churned++;
+        }
+    });
+
+    sleep_ms((long)(seconds * 1000));
+    stop_flag.store(true);
+    for (std::thread &t : threads) t.join();
+    for (cava_stream *stream : streams) cava_stream_stop(stream);
+    uint64_t restarts = cava_reader_restarts();
+    cava_reader_stop();
+
+    for (const Checker &checker : checkers) {
+        printf("%-18s %8llu frames\n", checker.name, (unsigned long long)checker.frames);
+        if (checker.frames == 0) fail(checker.name, "no frames");
+    }
+    printf("default instance restarted %llu times, %d streams started and stopped\n", (unsigned long long)restarts,
+           churned.load());
+    if (failures.load()) {
+        fprintf(stderr, "%d failures\n", failures.load());
+        return 1;
+    }
+    return 0;
+}